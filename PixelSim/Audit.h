@@ -0,0 +1,88 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Pixel.h"
+
+/*
+* Mass audit, catches the moves in CommitPixels that create or destroy material.
+* Every Interval ticks the moles of each material are added up (grid and free particles)
+* and compared to the totals at the start, minus what phase changes moved between materials.
+* The brush and clearing start a new baseline.
+*/
+namespace Audit {
+
+	bool Enabled = false;
+	size_t Interval = 60; //in ticks
+	int64_t Threshold = 0; //drift in moles units a material can have before it's reported
+
+	std::vector<int64_t> Expected;
+	std::vector<int64_t> Totals;
+	std::vector<int64_t> ConvertedAtBaseline;
+	size_t BaselineEdits = (size_t)-1;
+	size_t LastTick = (size_t)-1;
+	size_t LastCleanTick = 0; //last audited tick without drift
+	size_t DriftStartTick = 0;
+	bool Drifting = false;
+
+	//total moles per material id, one flat pass over the grid
+	void CountMoles(std::vector<int64_t>& totals) {
+		totals.assign(Pxl::MaterialCount, 0);
+		int64_t* sums = totals.data();
+		for (size_t i = 0; i < Pxl::PIXELGRID_WIDTH * Pxl::PIXELGRID_HEIGHT; i++) {
+			sums[Pxl::ActiveWorld->Pixels[i].ID] += Pxl::ActiveWorld->Pixels[i].Moles;
+		}
+		for (size_t i = 0; i < Pxl::ActiveWorld->FreeParticles.Size(); i++) {
+			sums[Pxl::ActiveWorld->FreeParticles.Payloads[i].ID] += Pxl::ActiveWorld->FreeParticles.Payloads[i].Moles;
+		}
+	}
+
+	void StartBaseline() {
+		CountMoles(Expected);
+		ConvertedAtBaseline.assign(Pxl::ActiveWorld->MolesConverted, Pxl::ActiveWorld->MolesConverted + Pxl::MaterialCount);
+		BaselineEdits = Pxl::ActiveWorld->EditCount;
+		LastCleanTick = Pxl::ActiveWorld->Tick;
+		Drifting = false;
+	}
+
+	void SetEnabled(bool enabled) {
+		Enabled = enabled;
+		if (Enabled) { StartBaseline(); }
+		printf("mass audit %s\n", Enabled ? "on" : "off");
+	}
+
+	//call after every update, returns false while any material has drifted past the threshold
+	bool Check() {
+		if (!Enabled || Pxl::ActiveWorld->Tick == LastTick) { return !Drifting; }
+		LastTick = Pxl::ActiveWorld->Tick;
+
+		if (BaselineEdits != Pxl::ActiveWorld->EditCount) {
+			StartBaseline();
+			return true;
+		}
+		if (Pxl::ActiveWorld->Tick % Interval != 0) { return !Drifting; }
+
+		CountMoles(Totals);
+		bool drifted = false;
+		for (size_t id = 0; id < Pxl::MaterialCount; id++) {
+			//phase changes move moles between materials on purpose
+			int64_t drift = Totals[id] - Expected[id] - (Pxl::ActiveWorld->MolesConverted[id] - ConvertedAtBaseline[id]);
+			if (drift > Threshold || -drift > Threshold) {
+				//only reported once, when it first shows up
+				if (!Drifting) {
+					printf("mass drift in %s: %+lld units (%+.4f moles), started after tick %zu, found at tick %zu\n",
+						Pxl::MaterialNames[id], (long long)drift, (double)drift / Pxl::MOLES_PER_PIXEL, LastCleanTick, Pxl::ActiveWorld->Tick);
+				}
+				drifted = true;
+			}
+		}
+
+		if (drifted && !Drifting) { DriftStartTick = LastCleanTick; }
+		if (!drifted) { LastCleanTick = Pxl::ActiveWorld->Tick; }
+		Drifting = drifted;
+		return !Drifting;
+	}
+}
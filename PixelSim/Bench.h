@@ -0,0 +1,429 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <thread>
+
+#include "Pixel.h"
+#include "Audit.h"
+#include "Engine.h"
+#include "Render.h"
+
+//headless benchmarks, run with "PixelSim.exe --bench"
+namespace Bench {
+
+	double ElapsedMs(Uint64 start) {
+		return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+	}
+
+	SDL_Rect WholeWorld() { return SDL_Rect{ 0, 0, (int)Pxl::PIXELGRID_WIDTH, (int)Pxl::PIXELGRID_HEIGHT }; }
+
+	//materials the test worlds use, vacuum if the materials file doesn't have them
+	uint8_t TestMaterial(const std::string& name) { return (uint8_t)std::max(0, Pxl::FindMaterial(name)); }
+
+	//loose sand with some water and stone ledges, identical for the same seed
+	void FillTestWorld(uint64_t seed) {
+		Pxl::SeedRandom(seed);
+		Pxl::ActiveWorld->FreeParticles.Clear();
+		uint8_t sand = TestMaterial("Sand");
+		uint8_t water = TestMaterial("Water");
+		uint8_t stone = TestMaterial("Stone");
+		for (size_t y = 0; y < Pxl::PIXELGRID_HEIGHT; y++) {
+			for (size_t x = 0; x < Pxl::PIXELGRID_WIDTH; x++) {
+				int roll = Pxl::RandomInt(99);
+				uint8_t type = Pxl::types::VACUUM;
+				if (y % 30 == 29 && x % 40 < 25) { type = stone; }
+				else if (roll < 35) { type = sand; }
+				else if (roll < 40) { type = water; }
+
+				Pxl::SetPixel(x, y, Pxl::NewPixel(type));
+				Pxl::ActiveWorld->Pixels[Pxl::GetIndex(x, y)].Moles = type == Pxl::types::VACUUM ? 0 : Pxl::MOLES_PER_PIXEL;
+			}
+		}
+		Pxl::WakeAllChunks();
+		Pxl::ActiveWorld->EditCount++;
+	}
+
+	//times whole simulation ticks on the test world
+	double TimeTicks(int ticks, Pxl::Engine& engine) {
+		FillTestWorld(1234);
+		Pxl::SelectEngine(engine);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < ticks; i++) {
+			Pxl::UpdatePixels(false, SDL_Point{ 0,0 }, SDL_Point{ 0,0 }, 0, false, 1);
+		}
+		return ElapsedMs(start) / ticks;
+	}
+
+	//steps an engine in lockstep with the reference on the test world, false if a bitwise engine diverges
+	bool Validate(Pxl::Engine& engine, int ticks) {
+		FillTestWorld(99);
+		Pxl::Validation::Session session;
+		session.Begin(engine, 99);
+		bool matches = true;
+		for (int i = 0; i < ticks && matches; i++) {
+			session.Step();
+			matches = !engine.Bitwise() || session.CheckBitwise();
+		}
+		if (!matches) {}
+		else if (engine.Bitwise()) {
+			printf("validation: %s matches the reference cell for cell over %d ticks\n", engine.Name(), ticks);
+		}
+		else {
+			session.ReportDistribution();
+		}
+		session.End(Pxl::MainWorld);
+		return matches;
+	}
+
+	//move rules alone over every cell of the test world, nothing is committed, in milliseconds per pass
+	double TimeMoves(int rounds, bool useSpecialised) {
+		FillTestWorld(1234);
+		Pxl::ActiveWorld->UseBitboardKernel = false;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int round = 0; round < rounds; round++) {
+			for (size_t x = 0; x < Pxl::PIXELGRID_WIDTH; x++)
+			for (size_t y = 0; y < Pxl::PIXELGRID_HEIGHT; y++) {
+				if (useSpecialised) { Pxl::UpdatePixelsMoveSpecialised(x, y); }
+				else { Pxl::UpdatePixelsMove(x, y); }
+			}
+			Pxl::ActiveWorld->PixelChangesBuffer.clear();
+			Pxl::ActiveWorld->PendingLifts.clear();
+		}
+		return ElapsedMs(start) / rounds;
+	}
+
+	struct KernelPlanes {
+		size_t Words;
+		std::vector<std::vector<uint64_t>> Planes;
+
+		KernelPlanes(size_t words, size_t count) : Words(words), Planes(count, std::vector<uint64_t>(words + 2 * Pxl::Bitboard::GUARD_WORDS)) {}
+
+		uint64_t* operator[](size_t i) { return Planes[i].data() + Pxl::Bitboard::GUARD_WORDS; }
+	};
+
+	//random masks through both kernels, returns the number of differing words
+	size_t ComparePowderKernels(int rounds) {
+		const size_t words = 8;
+		KernelPlanes in(words, 5);
+		KernelPlanes outScalar(words, 6);
+		KernelPlanes outAVX2(words, 6);
+		uint64_t state = 0x2545F4914F6CDD1Dull;
+		size_t mismatches = 0;
+
+		for (int round = 0; round < rounds; round++) {
+			for (size_t p = 0; p < 5; p++) {
+				for (size_t i = 0; i < words; i++) { in[p][i] = Pxl::Bitboard::NextRandomWord(state); }
+			}
+			//a cell can't be both empty and fluid
+			for (size_t i = 0; i < words; i++) { in[2][i] &= ~in[1][i]; }
+
+			Pxl::Bitboard::PowderRow row{ in[0], in[1], in[2], in[3], in[4] };
+			Pxl::Bitboard::PowderMoves scalar{ outScalar[0], outScalar[1], outScalar[2], outScalar[3], outScalar[4], outScalar[5] };
+			Pxl::Bitboard::PowderMoves avx2{ outAVX2[0], outAVX2[1], outAVX2[2], outAVX2[3], outAVX2[4], outAVX2[5] };
+			Pxl::Bitboard::ComputePowderMoves(row, scalar, words, false);
+			Pxl::Bitboard::ComputePowderMoves(row, avx2, words, true);
+
+			for (size_t p = 2; p < 6; p++) {
+				for (size_t i = 0; i < words; i++) { mismatches += outScalar[p][i] != outAVX2[p][i]; }
+			}
+		}
+		return mismatches;
+	}
+
+	//kernel alone over a full grid of rows, in nanoseconds per row
+	double TimePowderKernel(int rounds, bool useAVX2) {
+		using namespace Pxl::Bitboard;
+		FillTestWorld(1234);
+		BuildPlanes();
+
+		PowderMoves moves{ Row(LeftRow, 0), Row(RightRow, 0), Row(DownRow, 0), Row(DownLeftRow, 0), Row(DownRightRow, 0), nullptr };
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int round = 0; round < rounds; round++) {
+			for (size_t y = 0; y < Pxl::PIXELGRID_HEIGHT; y++) {
+				PowderRow row{ Row(PowderPlane, y), Row(EmptyPlane, y + 1), Row(FluidPlane, y + 1), Row(RandomPlaneA, y), Row(RandomPlaneB, y) };
+				moves.Fallback = Row(FallbackPlane, y);
+				ComputePowderMoves(row, moves, ROW_WORDS, useAVX2);
+			}
+		}
+		return ElapsedMs(start) * 1e6 / ((double)rounds * Pxl::PIXELGRID_HEIGHT);
+	}
+
+	//whole screen of steam at uneven pressure, in milliseconds per tick
+	double TimeGasCloud(int ticks) {
+		Pxl::SeedRandom(1234);
+		Pxl::ActiveWorld->FreeParticles.Clear();
+		for (size_t i = 0; i < Pxl::PIXELGRID_WIDTH * Pxl::PIXELGRID_HEIGHT; i++) {
+			Pxl::SetPixel(i, Pxl::NewPixel(TestMaterial("Steam")));
+			Pxl::ActiveWorld->Pixels[i].Moles = (uint16_t)(Pxl::MOLES_PER_PIXEL / 2 + Pxl::RandomInt((int)Pxl::MOLES_PER_PIXEL));
+		}
+		Pxl::ActiveWorld->EditCount++;
+		Pxl::SelectEngine(Pxl::Engines::Specialised);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < ticks; i++) {
+			Pxl::UpdatePixels(false, SDL_Point{ 0,0 }, SDL_Point{ 0,0 }, 0, false, 1);
+		}
+		return ElapsedMs(start) / ticks;
+	}
+
+	/* The same test worlds stepped one after another on this thread and then side by side on all cores.
+	* Returns false if any world ends up different, the threads may not share anything a tick writes */
+	bool CompareThreadedWorlds(size_t count, size_t ticks, Pxl::Engine& engine, double& sequentialMs, double& threadedMs) {
+		std::vector<std::unique_ptr<Pxl::World>> sequential, threaded;
+		std::vector<Pxl::World*> worlds;
+		for (size_t i = 0; i < count; i++) {
+			sequential.emplace_back(new Pxl::World());
+			Pxl::SetActiveWorld(*sequential.back());
+			FillTestWorld(1000 + i);
+			threaded.emplace_back(new Pxl::World(*sequential.back()));
+			worlds.push_back(threaded.back().get());
+		}
+		Pxl::SetActiveWorld(Pxl::MainWorld);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (size_t i = 0; i < count; i++) {
+			std::vector<Pxl::World*> one(1, sequential[i].get());
+			Pxl::StepWorlds(one, engine, ticks, 1);
+		}
+		sequentialMs = ElapsedMs(start);
+
+		start = SDL_GetPerformanceCounter();
+		Pxl::StepWorlds(worlds, engine, ticks);
+		threadedMs = ElapsedMs(start);
+
+		for (size_t i = 0; i < count; i++) {
+			for (size_t cell = 0; cell < Pxl::PIXELGRID_SIZE; cell++) {
+				if (!Pxl::Validation::SameCell(sequential[i]->Pixels[cell], threaded[i]->Pixels[cell])) {
+					printf("world %zu differs at cell %zu, %zu after stepping on its own thread\n", i, cell % Pxl::PIXELGRID_WIDTH, cell / Pxl::PIXELGRID_WIDTH);
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	//one conduction step with every chunk active, in milliseconds
+	double TimeHeat(int rounds) {
+		FillTestWorld(1234);
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int round = 0; round < rounds; round++) {
+			std::fill(Pxl::ActiveWorld->ChunkHeatAwake, Pxl::ActiveWorld->ChunkHeatAwake + Pxl::CHUNKS_X * Pxl::CHUNKS_Y, true);
+			Pxl::Heat::Conduct();
+		}
+		return ElapsedMs(start) / rounds;
+	}
+
+	//every texel kernel against the scalar one on the test world at a few scales, returns the number of texels that differ
+	size_t CompareTexelKernels(int level) {
+		FillTestWorld(1234);
+		Pxl::Palette::Update();
+		size_t mismatches = 0;
+		for (int scale : { 1, 2, 3, 8, PIXEL_SIZE }) {
+			std::vector<uint32_t> expected(Pxl::PIXELGRID_WIDTH * scale), actual(Pxl::PIXELGRID_WIDTH * scale);
+			for (size_t y = 0; y < Pxl::PIXELGRID_HEIGHT; y++) {
+				const uint8_t* ids = &Pxl::GetPixel(0, y).ID;
+				const uint8_t* variants = Pxl::Palette::VariantPlane(0, Pxl::PIXELGRID_WIDTH, Pxl::PIXELGRID_HEIGHT) + Pxl::GetIndex(0, y);
+				Pxl::Texels::ConvertRow(ids, sizeof(Pxl::Pixel), variants, Pxl::PIXELGRID_WIDTH, Pxl::Palette::Colors[Pxl::Palette::NORMAL], expected.data(), scale, Pxl::Texels::SCALAR);
+				Pxl::Texels::ConvertRow(ids, sizeof(Pxl::Pixel), variants, Pxl::PIXELGRID_WIDTH, Pxl::Palette::Colors[Pxl::Palette::NORMAL], actual.data(), scale, level);
+				for (size_t i = 0; i < expected.size(); i++) { mismatches += expected[i] != actual[i]; }
+			}
+		}
+		return mismatches;
+	}
+
+	/* A pyramid updated from the awake chunks every tick against one built from scratch at the end, with the brush
+	* painting now and then. Returns the number of mip cells that differ, any means a change didn't wake its chunk */
+	size_t CompareMips(Pxl::Engine& engine, int ticks, double& incrementalMs, double& fullMs) {
+		FillTestWorld(2468);
+		Pxl::SelectEngine(engine);
+		uint8_t sand = TestMaterial("Sand");
+		Pxl::Mips::Pyramid incremental;
+		incremental.Update();
+		incrementalMs = 0;
+		for (int tick = 0; tick < ticks; tick++) {
+			if (tick % 25 == 0) {
+				double x = (double)(tick * 7 % Pxl::PIXELGRID_WIDTH);
+				engine.Paint(Vector2{ x, 2 }, Vector2{ x + 20, 10 }, tick % 50 == 0 ? sand : (uint8_t)Pxl::types::VACUUM);
+			}
+			engine.Step();
+			Uint64 start = SDL_GetPerformanceCounter();
+			incremental.Update();
+			incrementalMs += ElapsedMs(start);
+		}
+		incrementalMs /= ticks;
+
+		Pxl::Mips::Pyramid full;
+		Uint64 start = SDL_GetPerformanceCounter();
+		full.Update();
+		fullMs = ElapsedMs(start);
+
+		size_t mismatches = 0;
+		for (int level = 1; level <= full.LevelCount(); level++) {
+			for (size_t i = 0; i < full.Get(level).Ids.size(); i++) { mismatches += full.Get(level).Ids[i] != incremental.Get(level).Ids[i]; }
+		}
+		return mismatches;
+	}
+
+	//the world drawn in row bands on worker threads against the same frame drawn on this thread, returns the number of texels that differ
+	size_t CompareBands(size_t threadCount, int scale) {
+		FillTestWorld(1234);
+		size_t pitch = Pxl::PIXELGRID_WIDTH * scale * sizeof(uint32_t);
+		std::vector<uint32_t> expected(Pxl::PIXELGRID_SIZE * scale * scale), actual(Pxl::PIXELGRID_SIZE * scale * scale);
+		Pxl::RenderWorkers.reset();
+		Pxl::DrawWorld(expected.data(), (int)pitch, scale, Pxl::PlaneAt(0), WholeWorld(), SDL_Point{ 0,0 }, 1);
+		Pxl::RenderWorkers.reset(new Pxl::Workers::Pool(threadCount));
+		Pxl::DrawWorld(actual.data(), (int)pitch, scale, Pxl::PlaneAt(0), WholeWorld(), SDL_Point{ 0,0 }, 1);
+		Pxl::RenderWorkers.reset();
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < expected.size(); i++) { mismatches += expected[i] != actual[i]; }
+		return mismatches;
+	}
+
+	//world to texels on the test world, what LoadPixels does before the upload, in milliseconds
+	double TimeDrawWorld(int rounds, int scale, int level, size_t threadCount = 0) {
+		FillTestWorld(1234);
+		int previous = Pxl::Texels::Level;
+		Pxl::Texels::Level = level;
+		Pxl::RenderWorkers.reset(threadCount > 0 ? new Pxl::Workers::Pool(threadCount) : nullptr);
+		std::vector<uint32_t> texels(Pxl::PIXELGRID_SIZE * scale * scale);
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int round = 0; round < rounds; round++) {
+			Pxl::DrawWorld(texels.data(), (int)(Pxl::PIXELGRID_WIDTH * scale * sizeof(uint32_t)), scale, Pxl::PlaneAt(0), WholeWorld(), SDL_Point{ 0,0 }, 1);
+		}
+		double ms = ElapsedMs(start) / rounds;
+		Pxl::Texels::Level = previous;
+		Pxl::RenderWorkers.reset();
+		return ms;
+	}
+
+	//test world with the mass audit on every tick, false as soon as a material drifts
+	bool AuditConservation(int ticks, Pxl::Engine& engine) {
+		FillTestWorld(4321);
+		Pxl::SelectEngine(engine);
+		Audit::Enabled = true;
+		Audit::Interval = 1;
+		Audit::Threshold = 0;
+		Audit::StartBaseline();
+
+		bool clean = true;
+		for (int i = 0; i < ticks && clean; i++) {
+			Pxl::UpdatePixels(false, SDL_Point{ 0,0 }, SDL_Point{ 0,0 }, 0, false, 1);
+			clean = Audit::Check();
+		}
+		Audit::Enabled = false;
+		return clean;
+	}
+
+	int Run() {
+		bool hasAVX2 = Pxl::Bitboard::HasAVX2();
+		std::string error;
+		if (!Pxl::LoadMaterials("Materials.txt", error)) {
+			printf("Failed to load materials! %s\n", error.c_str());
+			return 1;
+		}
+		bool passed = true;
+		const int ticks = 200;
+
+		printf("PixelSim benchmark, %zux%zu cells, AVX2 %s\n", Pxl::PIXELGRID_WIDTH, Pxl::PIXELGRID_HEIGHT, hasAVX2 ? "available" : "unavailable");
+
+		if (hasAVX2) {
+			size_t mismatches = ComparePowderKernels(10000);
+			printf("powder kernel AVX2 vs scalar reference: %zu mismatching words\n", mismatches);
+			passed = mismatches == 0;
+		}
+
+		int texelLevel = Pxl::Texels::Detect();
+		const char* texelNames[] = { "scalar", "AVX2" };
+		for (int level = Pxl::Texels::AVX2; level <= texelLevel; level++) {
+			size_t mismatches = CompareTexelKernels(level);
+			printf("texel kernel %s vs scalar: %zu mismatching texels\n", texelNames[level], mismatches);
+			passed &= mismatches == 0;
+		}
+
+		size_t bandMismatches = CompareBands(3, PIXEL_SIZE);
+		printf("texels in row bands on 3 threads vs one thread: %zu mismatching texels\n", bandMismatches);
+		passed &= bandMismatches == 0;
+
+		Pxl::BitboardUseAVX2 = hasAVX2;
+		for (size_t i = 1; i < Pxl::Engines::COUNT; i++) {
+			passed &= Validate(*Pxl::Engines::All[i], 300);
+		}
+
+		for (size_t i = 0; i < Pxl::Engines::COUNT; i++) {
+			bool clean = AuditConservation(1000, *Pxl::Engines::All[i]);
+			printf("mass audit, %s engine, 1000 ticks: %s\n", Pxl::Engines::All[i]->Name(), clean ? "no drift" : "DRIFT");
+			passed &= clean;
+		}
+
+		double kernelScalar = TimePowderKernel(2000, false);
+		printf("powder kernel, scalar bitboard: %8.1f ns/row\n", kernelScalar);
+		if (hasAVX2) {
+			double kernelAVX2 = TimePowderKernel(2000, true);
+			printf("powder kernel, AVX2 bitboard:   %8.1f ns/row (%.2fx)\n", kernelAVX2, kernelScalar / kernelAVX2);
+		}
+
+		double movesGeneric = TimeMoves(200, false);
+		printf("move rules, generic:            %8.3f ms\n", movesGeneric);
+		double movesSpecialised = TimeMoves(200, true);
+		printf("move rules, specialised:        %8.3f ms (%.2fx)\n", movesSpecialised, movesGeneric / movesSpecialised);
+
+		double tickGeneric = TimeTicks(ticks, Pxl::Engines::Reference);
+		printf("tick, per-cell path, generic:   %8.3f ms\n", tickGeneric);
+		double tickScalar = TimeTicks(ticks, Pxl::Engines::Specialised);
+		printf("tick, per-cell path:            %8.3f ms (%.2fx)\n", tickScalar, tickGeneric / tickScalar);
+		Pxl::BitboardUseAVX2 = false;
+		double tickBitboard = TimeTicks(ticks, Pxl::Engines::BitboardPowders);
+		printf("tick, scalar bitboard powders:  %8.3f ms (%.2fx)\n", tickBitboard, tickScalar / tickBitboard);
+		if (hasAVX2) {
+			Pxl::BitboardUseAVX2 = true;
+			double tickAVX2 = TimeTicks(ticks, Pxl::Engines::BitboardPowders);
+			printf("tick, AVX2 bitboard powders:    %8.3f ms (%.2fx)\n", tickAVX2, tickScalar / tickAVX2);
+		}
+
+		double tickMargolus = TimeTicks(ticks, Pxl::Engines::MargolusBlocks);
+		printf("tick, Margolus blocks:          %8.3f ms (%.2fx)\n", tickMargolus, tickScalar / tickMargolus);
+
+		printf("heat step, whole grid active:   %8.3f ms\n", TimeHeat(500));
+		printf("tick, screen full of steam:     %8.3f ms\n", TimeGasCloud(ticks));
+		for (int scale : { 1, PIXEL_SIZE }) {
+			double texelsScalar = 0;
+			for (int level = Pxl::Texels::SCALAR; level <= texelLevel; level++) {
+				double texels = TimeDrawWorld(scale == 1 ? 2000 : 200, scale, level);
+				if (level == Pxl::Texels::SCALAR) { texelsScalar = texels; }
+				char label[64];
+				snprintf(label, sizeof(label), "texels %zux%zu, %s:", Pxl::PIXELGRID_WIDTH * scale, Pxl::PIXELGRID_HEIGHT * scale, texelNames[level]);
+				printf("%-31s %8.3f ms (%.2fx)\n", label, texels, texelsScalar / texels);
+			}
+			const size_t workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+			if (workers > 0) {
+				double texels = TimeDrawWorld(scale == 1 ? 2000 : 200, scale, texelLevel, workers);
+				char label[64];
+				snprintf(label, sizeof(label), "texels %zux%zu, %u threads:", Pxl::PIXELGRID_WIDTH * scale, Pxl::PIXELGRID_HEIGHT * scale, (unsigned)workers + 1);
+				printf("%-31s %8.3f ms (%.2fx)\n", label, texels, texelsScalar / texels);
+			}
+		}
+
+		for (size_t i = 0; i < Pxl::Engines::COUNT; i++) {
+			double incrementalMs, fullMs;
+			size_t mismatches = CompareMips(*Pxl::Engines::All[i], 500, incrementalMs, fullMs);
+			printf("mip pyramid, %s engine, 500 ticks: %zu stale cells, %.3f ms a tick updating awake chunks, %.3f ms rebuilt\n", Pxl::Engines::All[i]->Name(), mismatches, incrementalMs, fullMs);
+			passed &= mismatches == 0;
+		}
+
+		const size_t worldCount = std::max<size_t>(4, std::thread::hardware_concurrency());
+		for (Pxl::Engine* engine : { (Pxl::Engine*)&Pxl::Engines::Specialised, (Pxl::Engine*)&Pxl::Engines::MargolusBlocks }) {
+			double sequentialMs, threadedMs;
+			bool same = CompareThreadedWorlds(worldCount, ticks, *engine, sequentialMs, threadedMs);
+			printf("%zu worlds, %s, %d ticks: %.1f ms in turn, %.1f ms on %u threads (%.2fx), %s\n", worldCount, engine->Name(), ticks,
+				sequentialMs, threadedMs, std::thread::hardware_concurrency(), sequentialMs / threadedMs, same ? "same results" : "RESULTS DIFFER");
+			passed &= same;
+		}
+
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PXL_X86 1
+#include <immintrin.h>
+#else
+#define PXL_X86 0
+#endif
+
+//MSVC allows AVX2 intrinsics anywhere, gcc/clang need the function to opt in
+#if defined(__GNUC__) || defined(__clang__)
+#define PXL_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define PXL_AVX2_TARGET
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if PXL_X86 && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+/*
+* Row-at-a-time powder rule ("fall down, else fall diagonally") on bitmasks.
+* Bit x of a row word array is cell x of that row. Every row array has one zero guard
+* word on each side so neighbours can be read with plain offset loads.
+*/
+namespace Pxl {
+	namespace Bitboard {
+
+		const size_t GUARD_WORDS = 1;
+
+		//rows are padded to 256 cells so the AVX2 kernel never needs a tail loop
+		size_t RowWords(size_t width) { return ((width + 255) / 256) * 4; }
+		size_t RowStride(size_t width) { return RowWords(width) + 2 * GUARD_WORDS; }
+
+		//the cpu has to support it and the os has to save the ymm registers
+		bool HasAVX2() {
+#if PXL_X86 && defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) { return false; }
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#elif PXL_X86
+			unsigned int a, b, c, d;
+			if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_OSXSAVE)) { return false; }
+			unsigned int xcrLow, xcrHigh;
+			__asm__("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+			if ((xcrLow & 6) != 6) { return false; }
+			__cpuid_count(7, 0, a, b, c, d);
+			return (b & bit_AVX2) != 0;
+#else
+			return false;
+#endif
+		}
+
+		int CountTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER)
+			unsigned long index;
+#if defined(_M_X64)
+			_BitScanForward64(&index, word);
+#else
+			if (!_BitScanForward(&index, (unsigned long)word)) {
+				_BitScanForward(&index, (unsigned long)(word >> 32));
+				index += 32;
+			}
+#endif
+			return (int)index;
+#else
+			return __builtin_ctzll(word);
+#endif
+		}
+
+		//all pointers point at the first real word, [-1] and [words] are guards
+		struct PowderRow {
+			const uint64_t* Powder;  //movable powder on row y
+			const uint64_t* Empty;   //vacuum on row y + 1
+			const uint64_t* Fluid;   //liquids/gases and possibly lighter powders on row y + 1, those need a mass check
+			const uint64_t* RandomA; //picks a side when both diagonals are open
+			const uint64_t* RandomB; //picks a winner when two diagonals land on one cell
+		};
+
+		struct PowderMoves {
+			uint64_t* Left;      //scratch: source bits falling down-left
+			uint64_t* Right;     //scratch: source bits falling down-right
+			uint64_t* Down;      //target bit x on row y + 1 receives from x, y
+			uint64_t* DownLeft;  //target bit x on row y + 1 receives from x + 1, y
+			uint64_t* DownRight; //target bit x on row y + 1 receives from x - 1, y
+			uint64_t* Fallback;  //source bits that have to go through the scalar path
+		};
+
+		//reference implementation, the SIMD kernels have to match it bit for bit
+		void ComputePowderMovesScalar(const PowderRow& row, const PowderMoves& moves, size_t words) {
+			for (size_t i = 0; i < words; i++) {
+				uint64_t e = row.Empty[i];
+				uint64_t eL = (e << 1) | (row.Empty[i - 1] >> 63); //bit x: x - 1 is empty
+				uint64_t eR = (e >> 1) | (row.Empty[i + 1] << 63); //bit x: x + 1 is empty
+				uint64_t f = row.Fluid[i];
+				uint64_t fL = (f << 1) | (row.Fluid[i - 1] >> 63);
+				uint64_t fR = (f >> 1) | (row.Fluid[i + 1] << 63);
+
+				uint64_t down = row.Powder[i] & e;
+				uint64_t rest = row.Powder[i] & ~e;
+				uint64_t fallback = rest & (f | fL | fR);
+				rest &= ~fallback;
+
+				uint64_t canL = rest & eL;
+				uint64_t canR = rest & eR;
+				uint64_t both = canL & canR;
+
+				moves.Down[i] = down;
+				moves.Fallback[i] = fallback;
+				moves.Left[i] = (canL & ~canR) | (both & row.RandomA[i]);
+				moves.Right[i] = (canR & ~canL) | (both & ~row.RandomA[i]);
+			}
+
+			//resolve conflicts on the target row: straight falls win, diagonal clashes are random
+			for (size_t i = 0; i < words; i++) {
+				uint64_t down = moves.Down[i];
+				uint64_t tL = ((moves.Left[i] >> 1) | (moves.Left[i + 1] << 63)) & ~down;
+				uint64_t tR = ((moves.Right[i] << 1) | (moves.Right[i - 1] >> 63)) & ~down;
+				uint64_t clash = tL & tR;
+
+				moves.DownLeft[i] = tL & ~(clash & ~row.RandomB[i]);
+				moves.DownRight[i] = tR & ~(clash & row.RandomB[i]);
+			}
+		}
+
+#if PXL_X86
+		PXL_AVX2_TARGET inline __m256i Load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+		PXL_AVX2_TARGET inline void Store(uint64_t* p, __m256i v) { _mm256_storeu_si256((__m256i*)p, v); }
+
+		//bit x <- bit x - 1, carrying across words
+		PXL_AVX2_TARGET inline __m256i ShiftUp(const uint64_t* p) {
+			return _mm256_or_si256(_mm256_slli_epi64(Load(p), 1), _mm256_srli_epi64(Load(p - 1), 63));
+		}
+		//bit x <- bit x + 1, carrying across words
+		PXL_AVX2_TARGET inline __m256i ShiftDown(const uint64_t* p) {
+			return _mm256_or_si256(_mm256_srli_epi64(Load(p), 1), _mm256_slli_epi64(Load(p + 1), 63));
+		}
+
+		//256 cells per iteration, same logic as ComputePowderMovesScalar
+		PXL_AVX2_TARGET void ComputePowderMovesAVX2(const PowderRow& row, const PowderMoves& moves, size_t words) {
+			for (size_t i = 0; i < words; i += 4) {
+				__m256i p = Load(row.Powder + i);
+				__m256i e = Load(row.Empty + i);
+				__m256i f = Load(row.Fluid + i);
+				__m256i fNear = _mm256_or_si256(f, _mm256_or_si256(ShiftUp(row.Fluid + i), ShiftDown(row.Fluid + i)));
+
+				__m256i down = _mm256_and_si256(p, e);
+				__m256i rest = _mm256_andnot_si256(e, p);
+				__m256i fallback = _mm256_and_si256(rest, fNear);
+				rest = _mm256_andnot_si256(fallback, rest);
+
+				__m256i canL = _mm256_and_si256(rest, ShiftUp(row.Empty + i));
+				__m256i canR = _mm256_and_si256(rest, ShiftDown(row.Empty + i));
+				__m256i both = _mm256_and_si256(canL, canR);
+				__m256i r = Load(row.RandomA + i);
+
+				Store(moves.Down + i, down);
+				Store(moves.Fallback + i, fallback);
+				Store(moves.Left + i, _mm256_or_si256(_mm256_andnot_si256(canR, canL), _mm256_and_si256(both, r)));
+				Store(moves.Right + i, _mm256_or_si256(_mm256_andnot_si256(canL, canR), _mm256_andnot_si256(r, both)));
+			}
+
+			for (size_t i = 0; i < words; i += 4) {
+				__m256i down = Load(moves.Down + i);
+				__m256i tL = _mm256_andnot_si256(down, ShiftDown(moves.Left + i));
+				__m256i tR = _mm256_andnot_si256(down, ShiftUp(moves.Right + i));
+				__m256i clash = _mm256_and_si256(tL, tR);
+				__m256i r = Load(row.RandomB + i);
+
+				Store(moves.DownLeft + i, _mm256_andnot_si256(_mm256_andnot_si256(r, clash), tL));
+				Store(moves.DownRight + i, _mm256_andnot_si256(_mm256_and_si256(clash, r), tR));
+			}
+		}
+#endif
+
+		void ComputePowderMoves(const PowderRow& row, const PowderMoves& moves, size_t words, bool useAVX2) {
+#if PXL_X86
+			if (useAVX2) {
+				ComputePowderMovesAVX2(row, moves, words);
+				return;
+			}
+#endif
+			ComputePowderMovesScalar(row, moves, words);
+		}
+
+		//xorshift64*, cheap enough to fill a random word per mask word every tick
+		uint64_t NextRandomWord(uint64_t& state) {
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return state * 2685821657736338717ull;
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+
+#include "Pixel.h"
+#include "Vector2.h"
+
+/*
+* Which part of the world the window shows. X and Y are the cell at the window's top left corner, can be fractional,
+* and Zoom is window pixels per cell. Mouse positions become cells through the camera and only the cells it sees are drawn.
+*/
+namespace Pxl {
+	class Camera {
+	public:
+		static constexpr double MIN_ZOOM = 1.0 / 16;
+		static constexpr double MAX_ZOOM = 64;
+		//one mouse wheel notch
+		static constexpr double ZOOM_STEP = 1.25;
+
+		double X = 0;
+		double Y = 0;
+		double Zoom = PIXEL_SIZE;
+
+		Camera(int screenWidth, int screenHeight) : ScreenWidth(screenWidth), ScreenHeight(screenHeight) {}
+
+		Vector2 ScreenToCells(SDL_Point position) const { return Vector2{ X + position.x / Zoom, Y + position.y / Zoom }; }
+
+		//the cell under a window position, can be outside the world
+		SDL_Point CellAt(SDL_Point position) const {
+			Vector2 cell = ScreenToCells(position);
+			return SDL_Point{ (int)std::floor(cell.x), (int)std::floor(cell.y) };
+		}
+
+		//where cells x, y to x + w, y + h end up in the window
+		SDL_FRect CellsToScreen(const SDL_Rect& cells) const {
+			return SDL_FRect{ (float)((cells.x - X) * Zoom), (float)((cells.y - Y) * Zoom), (float)(cells.w * Zoom), (float)(cells.h * Zoom) };
+		}
+
+		//cells that are at least partly in the window, clipped to the world
+		SDL_Rect VisibleCells() const {
+			int left = (int)std::max(0.0, std::floor(X));
+			int top = (int)std::max(0.0, std::floor(Y));
+			int right = (int)std::min((double)PIXELGRID_WIDTH, std::ceil(X + ScreenWidth / Zoom));
+			int bottom = (int)std::min((double)PIXELGRID_HEIGHT, std::ceil(Y + ScreenHeight / Zoom));
+			return SDL_Rect{ left, top, std::max(0, right - left), std::max(0, bottom - top) };
+		}
+
+		//by window pixels
+		void Pan(double dx, double dy) {
+			X += dx / Zoom;
+			Y += dy / Zoom;
+			Clamp();
+		}
+
+		//the cell under the window position stays where it is
+		void ZoomAt(SDL_Point position, double factor) {
+			Vector2 anchor = ScreenToCells(position);
+			//not std::min/max, those take the limits by reference and would need them defined outside the class
+			double zoom = Zoom * factor;
+			Zoom = zoom < MIN_ZOOM ? MIN_ZOOM : (zoom > MAX_ZOOM ? MAX_ZOOM : zoom);
+			X = anchor.x - position.x / Zoom;
+			Y = anchor.y - position.y / Zoom;
+			Clamp();
+		}
+
+		//puts the cell in the middle of the window
+		void CenterOn(double x, double y) {
+			X = x - ScreenWidth / Zoom / 2;
+			Y = y - ScreenHeight / Zoom / 2;
+			Clamp();
+		}
+
+		//how many cells fit across and down the window
+		Vector2 ViewCells() const { return Vector2{ ScreenWidth / Zoom, ScreenHeight / Zoom }; }
+
+		//the whole world at PIXEL_SIZE from the top left, the view before the camera existed
+		void Reset() {
+			X = 0;
+			Y = 0;
+			Zoom = PIXEL_SIZE;
+		}
+
+	private:
+		int ScreenWidth;
+		int ScreenHeight;
+
+		//the middle of the window stays over the world
+		void Clamp() {
+			double halfWidth = ScreenWidth / Zoom / 2;
+			double halfHeight = ScreenHeight / Zoom / 2;
+			X = std::min(std::max(X + halfWidth, 0.0), (double)PIXELGRID_WIDTH) - halfWidth;
+			Y = std::min(std::max(Y + halfHeight, 0.0), (double)PIXELGRID_HEIGHT) - halfHeight;
+		}
+	};
+
+	Camera View(SCREEN_WIDTH, SCREEN_HEIGHT);
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "Pixel.h"
+
+/*
+* Engines are the different ways of stepping the world in Pixels, all of them follow the same rules.
+* The reference is the generic per-cell path and the others are checked against it: cell for cell
+* if they claim to be bitwise, otherwise by where each material ends up.
+*/
+namespace Pxl {
+
+	class Engine {
+	public:
+		virtual ~Engine() {}
+
+		virtual const char* Name() const = 0;
+		//same world and seed in, same world out as the reference
+		virtual bool Bitwise() const = 0;
+
+		//called when the engine takes over, what the last one left asleep might not be settled for this one
+		virtual void Init() { WakeAllChunks(); }
+		//one unpaused tick
+		virtual void Step() = 0;
+		//start and end in cells, vacuum clears
+		virtual void Paint(Vector2 start, Vector2 end, uint8_t id) { PaintLine(start, end, id); }
+		virtual const Pixel& ReadCell(size_t x, size_t y) const { return GetPixel(x, y); }
+	};
+
+	//generic move rules, the one the others are checked against
+	class ReferenceEngine : public Engine {
+	public:
+		const char* Name() const { return "reference"; }
+		bool Bitwise() const { return true; }
+		void Step() {
+			ActiveWorld->UseMargolus = false;
+			ActiveWorld->UseBitboardKernel = false;
+			ActiveWorld->UseSpecialisedKernels = false;
+			StepTick();
+		}
+	};
+
+	class SpecialisedEngine : public Engine {
+	public:
+		const char* Name() const { return "specialised"; }
+		bool Bitwise() const { return true; }
+		void Step() {
+			ActiveWorld->UseMargolus = false;
+			ActiveWorld->UseBitboardKernel = false;
+			ActiveWorld->UseSpecialisedKernels = true;
+			StepTick();
+		}
+	};
+
+	//powders draw from the kernel's own random planes, so they land differently
+	class BitboardEngine : public Engine {
+	public:
+		const char* Name() const { return BitboardUseAVX2 ? "bitboard (AVX2)" : "bitboard (scalar)"; }
+		bool Bitwise() const { return false; }
+		void Step() {
+			ActiveWorld->UseMargolus = false;
+			ActiveWorld->UseBitboardKernel = true;
+			ActiveWorld->UseSpecialisedKernels = true;
+			StepTick();
+		}
+	};
+
+	class MargolusEngine : public Engine {
+	public:
+		const char* Name() const { return "margolus"; }
+		bool Bitwise() const { return false; }
+		void Step() {
+			ActiveWorld->UseMargolus = true;
+			ActiveWorld->UseBitboardKernel = false;
+			ActiveWorld->UseSpecialisedKernels = true;
+			StepTick();
+		}
+	};
+
+	namespace Engines {
+		ReferenceEngine Reference;
+		SpecialisedEngine Specialised;
+		BitboardEngine BitboardPowders;
+		MargolusEngine MargolusBlocks;
+
+		Engine* const All[] = { &Reference, &Specialised, &BitboardPowders, &MargolusBlocks };
+		const size_t COUNT = sizeof(All) / sizeof(All[0]);
+	}
+
+	Engine* ActiveEngine = &Engines::Specialised;
+
+	void SelectEngine(Engine& engine) {
+		ActiveEngine = &engine;
+		engine.Init();
+	}
+
+	//F2
+	void NextEngine() {
+		size_t current = 0;
+		while (Engines::All[current] != ActiveEngine) { current++; }
+		SelectEngine(*Engines::All[(current + 1) % Engines::COUNT]);
+		printf("engine: %s\n", ActiveEngine->Name());
+	}
+
+	//---VALIDATION---
+	namespace Validation {
+
+		bool SameCell(const Pixel& a, const Pixel& b) {
+			return a.ID == b.ID && a.Moles == b.Moles && a.Temperature == b.Temperature && a.Velocity.y == b.Velocity.y;
+		}
+
+		//cells and average height of every material, for engines that can't match cell for cell
+		struct Distribution {
+			std::vector<size_t> Cells;
+			std::vector<double> MeanY;
+		};
+
+		void Measure(const Engine& engine, Distribution& distribution) {
+			distribution.Cells.assign(MaterialCount, 0);
+			distribution.MeanY.assign(MaterialCount, 0.0);
+			for (size_t y = 0; y < PIXELGRID_HEIGHT; y++)
+			for (size_t x = 0; x < PIXELGRID_WIDTH; x++) {
+				uint8_t id = engine.ReadCell(x, y).ID;
+				distribution.Cells[id]++;
+				distribution.MeanY[id] += (double)y;
+			}
+			for (size_t id = 0; id < MaterialCount; id++) {
+				if (distribution.Cells[id] > 0) { distribution.MeanY[id] /= (double)distribution.Cells[id]; }
+			}
+		}
+
+		/* Two copies of the world, one stepped by the reference and one by the candidate. Each carries its
+		* own random state, seeded the same, and the candidate's copy is left active after each step */
+		struct Session {
+			Engine* Candidate = nullptr;
+			std::unique_ptr<World> ReferenceWorld;
+			std::unique_ptr<World> CandidateWorld;
+			size_t Ticks = 0;
+			bool Diverged = false;
+
+			//copies the active world
+			void Begin(Engine& candidate, uint64_t seed) {
+				Candidate = &candidate;
+				Ticks = 0;
+				Diverged = false;
+				ReferenceWorld.reset(new World(*ActiveWorld));
+				CandidateWorld.reset(new World(*ActiveWorld));
+
+				SetActiveWorld(*ReferenceWorld);
+				SeedRandom(seed);
+				Engines::Reference.Init();
+				SetActiveWorld(*CandidateWorld);
+				SeedRandom(seed);
+				Candidate->Init();
+			}
+
+			void Step() {
+				SetActiveWorld(*ReferenceWorld);
+				Engines::Reference.Step();
+				SetActiveWorld(*CandidateWorld);
+				Candidate->Step();
+				Ticks++;
+			}
+
+			void Paint(Vector2 start, Vector2 end, uint8_t id) {
+				SetActiveWorld(*ReferenceWorld);
+				Engines::Reference.Paint(start, end, id);
+				SetActiveWorld(*CandidateWorld);
+				Candidate->Paint(start, end, id);
+			}
+
+			//puts the candidate's world into home and makes that active again
+			void End(World& home) {
+				home = *CandidateWorld;
+				SetActiveWorld(home);
+				ReferenceWorld.reset();
+				CandidateWorld.reset();
+			}
+
+			//first differing cell in index order, false if there is none
+			bool FindDivergence(size_t& index) const {
+				for (index = 0; index < PIXELGRID_SIZE; index++) {
+					if (!SameCell(ReferenceWorld->Pixels[index], CandidateWorld->Pixels[index])) { return true; }
+				}
+				return false;
+			}
+
+			//bitwise engines are compared after every step, prints the first divergence once and returns false from then on
+			bool CheckBitwise() {
+				size_t index;
+				if (Diverged || !FindDivergence(index)) { return !Diverged; }
+				Diverged = true;
+
+				const Pixel& expected = ReferenceWorld->Pixels[index];
+				const Pixel& got = CandidateWorld->Pixels[index];
+				printf("validation: %s diverged from the reference on tick %zu at cell %zu, %zu\n", Candidate->Name(), Ticks, index % PIXELGRID_WIDTH, index / PIXELGRID_WIDTH);
+				printf("  reference:  %s, %u moles, %.3f C, velocity %.3f\n", MaterialNames[expected.ID], expected.Moles, expected.Temperature, expected.Velocity.y);
+				printf("  %-11s %s, %u moles, %.3f C, velocity %.3f\n", (std::string(Candidate->Name()) + ":").c_str(), MaterialNames[got.ID], got.Moles, got.Temperature, got.Velocity.y);
+				return false;
+			}
+
+			//how far apart the materials have ended up, in cells of average height, returns the largest gap
+			double ReportDistribution() {
+				Distribution expected, got;
+				SetActiveWorld(*ReferenceWorld);
+				Measure(Engines::Reference, expected);
+				SetActiveWorld(*CandidateWorld);
+				Measure(*Candidate, got);
+
+				size_t worst = 0;
+				double worstGap = 0.0;
+				for (size_t id = 1; id < MaterialCount; id++) {
+					if (expected.Cells[id] == 0 || got.Cells[id] == 0) { continue; }
+					double gap = std::abs(expected.MeanY[id] - got.MeanY[id]);
+					if (gap > worstGap) {
+						worst = id;
+						worstGap = gap;
+					}
+				}
+				if (worst == 0) {
+					printf("validation: %s vs reference after %zu ticks, nothing to compare\n", Candidate->Name(), Ticks);
+					return 0.0;
+				}
+				printf("validation: %s vs reference after %zu ticks, %s is furthest apart: %.2f cells in average height, %zu vs %zu cells\n",
+					Candidate->Name(), Ticks, MaterialNames[worst], worstGap, got.Cells[worst], expected.Cells[worst]);
+				return worstGap;
+			}
+		};
+
+		//F4, runs the active engine against the reference on the world as it is
+		bool Enabled = false;
+		size_t ReportInterval = 120; //in ticks, for engines that aren't bitwise
+		Session Live;
+
+		void SetEnabled(bool enabled) {
+			if (enabled && ActiveEngine == &Engines::Reference) {
+				printf("validation: pick another engine first, this one is the reference\n");
+				return;
+			}
+			if (enabled == Enabled) { return; }
+			Enabled = enabled;
+			if (Enabled) {
+				Live.Begin(*ActiveEngine, 1234);
+				printf("validation on, %s against the reference, %s\n", ActiveEngine->Name(), ActiveEngine->Bitwise() ? "cell for cell" : "by distribution");
+			}
+			else {
+				//carries on from where the candidate got to
+				Live.End(MainWorld);
+				printf("validation off\n");
+			}
+		}
+
+		void Step() {
+			Live.Step();
+			if (Live.Candidate->Bitwise()) {
+				//nothing more to learn once they differ, keep going with the candidate's world
+				if (!Live.CheckBitwise()) { SetEnabled(false); }
+			}
+			else if (Live.Ticks % ReportInterval == 0) {
+				Live.ReportDistribution();
+			}
+		}
+	}
+
+	//---WORLDS---
+	/* Steps every world the given number of ticks with the same engine, spread over up to one thread per core.
+	* A world is only ever touched by the thread that took it, the materials have to stay as they are until this returns */
+	void StepWorlds(std::vector<World*>& worlds, Engine& engine, size_t ticks, size_t threadCount = std::thread::hardware_concurrency()) {
+		threadCount = std::max<size_t>(1, std::min(threadCount, worlds.size()));
+		std::atomic<size_t> next(0);
+		auto work = [&]() {
+			for (size_t i = next++; i < worlds.size(); i = next++) {
+				SetActiveWorld(*worlds[i]);
+				engine.Init();
+				for (size_t tick = 0; tick < ticks; tick++) { engine.Step(); }
+			}
+		};
+
+		World* caller = ActiveWorld;
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < threadCount; i++) { threads.emplace_back(work); }
+		work();
+		for (std::thread& thread : threads) { thread.join(); }
+		SetActiveWorld(*caller);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdio.h>
+#include <cmath>
+
+#include "Helper.h"
+#include "Pixel.h"
+#include "Engine.h"
+#include "Camera.h"
+
+//what the game adds on top of the simulation core: the brush, drawing is in Render.h and mouse to cell mapping in Camera.h
+namespace Pxl {
+
+	uint8_t SelectedMaterial = types::VACUUM;
+
+	//places the selected material along the line the mouse moved since last frame, X1 clears
+	void ApplyBrush(SDL_Point mPosition, SDL_Point mPositionOld, Uint32 mButton) {
+		if (mButton != SDL_BUTTON_LEFT && mButton != SDL_BUTTON_X1) { return; }
+		uint8_t id = mButton == SDL_BUTTON_LEFT ? SelectedMaterial : (uint8_t)types::VACUUM;
+		if (Validation::Enabled) { Validation::Live.Paint(View.ScreenToCells(mPosition), View.ScreenToCells(mPositionOld), id); }
+		else { ActiveEngine->Paint(View.ScreenToCells(mPosition), View.ScreenToCells(mPositionOld), id); }
+	}
+
+	void UpdatePixels(bool isPaused, SDL_Point mPosition, SDL_Point mPositionOld, Uint32 mButton, bool mouseClick, int pxlState) {
+		//placing pixels
+		if (mButton && pxlState == 2) { ApplyBrush(mPosition, mPositionOld, mButton); }
+
+		if (isPaused) { return; }
+		if (Validation::Enabled) { Validation::Step(); }
+		else { ActiveEngine->Step(); }
+	}
+}
@@ -7,12 +7,16 @@
 #include <SDL_ttf.h>
 
 #include "Helper.h"
+#include "Pacer.h"
 
 namespace Gfx {
-	void DrawFPScounter(float fps) {
-		std::string fps_counter = "FPS: " + std::to_string(fps);
+	//the average and how far frame times stray from it, the second number is what shows as stutter
+	void DrawFPScounter(const Pacer::FrameStats& stats) {
+		char fps_counter[96];
+		snprintf(fps_counter, sizeof(fps_counter), "FPS: %.1f  frame %.2f ms +- %.2f (%.2f - %.2f)",
+			stats.MeanMs > 0 ? 1000.0 / stats.MeanMs : 0.0, stats.MeanMs, stats.DeviationMs, stats.MinMs, stats.MaxMs);
 		SDL_Color textColor = { 255, 255, 255, 0 };
-		SDL_Surface* textSurface = TTF_RenderText_Solid(gFont, fps_counter.c_str(), textColor);
+		SDL_Surface* textSurface = TTF_RenderText_Solid(gFont, fps_counter, textColor);
 		SDL_Texture* text = SDL_CreateTextureFromSurface(gRenderer, textSurface);
 		int text_width = textSurface->w;
 		int text_height = textSurface->h;
@@ -11,7 +11,8 @@
 #include <memory>
 
 #include "Graphics.h"
-#include "Pixel.h"
+#include "Game.h"
+#include "Render.h"
 
 namespace Gui {
 
@@ -71,7 +72,13 @@ namespace Gui {
 
 		int currentMap = 0;
 
+		//takes all input and stops the world while it's on top
+		bool Modal = false;
+
 		virtual void Update(bool mouseClick, double deltaTime) {}
+
+		//still moving on its own, the game doesn't go idle while any gui is
+		virtual bool IsAnimating() const { return false; }
 	};
 
 	std::vector<std::unique_ptr<BaseGUI>> Guis;
@@ -80,6 +87,7 @@ namespace Gui {
 		//CLASS: PIXELPICKER;
 		class PixelPicker : public BaseGUI {
 		private:
+			static const int BUTTONS_PER_ROW = 5;
 
 			//Screens
 			class MainScreen : public GuiMap {
@@ -115,18 +123,19 @@ namespace Gui {
 
 					MainScreen* Parent;
 
-					Pxl::Pixel Pixel;
+					uint8_t Material;
 
 					SDL_Color TtfColor;
 
-					PixelButton(MainScreen* parent, Pxl::Pixel pixel, SDL_Point offset) {
+					PixelButton(MainScreen* parent, uint8_t material, SDL_Point offset) {
 						Parent = parent;
-						Pixel = pixel;
+						Material = material;
 
 						useTexture = false;
-						Color = pixel.Color;
+						const Pxl::RGBA& color = Pxl::Materials[material].Color;
+						Color = SDL_Color{ color.r, color.g, color.b, color.a };
 
-						float avgColor = (float)((int)pixel.Color.r + (int)pixel.Color.b + (int)pixel.Color.g) / 3;
+						float avgColor = (float)((int)Color.r + (int)Color.b + (int)Color.g) / 3;
 						avgColor = 255 - avgColor;
 
 						TtfColor = SDL_Color{ (Uint8)avgColor, (Uint8)avgColor, (Uint8)avgColor };
@@ -135,7 +144,7 @@ namespace Gui {
 					}
 
 					void TtfName() {
-						std::string display = Pixel.Name;
+						std::string display = Pxl::MaterialNames[Material];
 						SDL_Color textColor = TtfColor;
 						SDL_Surface* textSurface = TTF_RenderText_Solid(gFont, display.c_str(), textColor);
 						SDL_Texture* text = SDL_CreateTextureFromSurface(gRenderer, textSurface);
@@ -156,7 +165,7 @@ namespace Gui {
 						if (isInsideRect(Zone, mPosition) && mouseClick) {
 							mouseInGui = true;
 
-							Pxl::selectedPixel = Pixel;
+							Pxl::SelectedMaterial = Material;
 
 							//closes gui
 							Guis.erase(Guis.end() - 1);
@@ -175,10 +184,12 @@ namespace Gui {
 
 					Buttons.push_back(std::make_unique<CloseButton>(this));
 
-					//pixels
-					Buttons.push_back(std::make_unique<PixelButton>(this, Pxl::PixelTypes[Pxl::types::WATER], SDL_Point{ 28,28 }));
-					Buttons.push_back(std::make_unique<PixelButton>(this, Pxl::PixelTypes[Pxl::types::SAND], SDL_Point{ 28 * 4,28 }));
-					Buttons.push_back(std::make_unique<PixelButton>(this, Pxl::PixelTypes[Pxl::types::STONE], SDL_Point{ 28 * 7,28 }));
+					//pixels, one button per material from the materials file
+					for (size_t i = 1; i < Pxl::MaterialCount; i++) {
+						int column = (int)(i - 1) % BUTTONS_PER_ROW;
+						int row = (int)(i - 1) / BUTTONS_PER_ROW;
+						Buttons.push_back(std::make_unique<PixelButton>(this, (uint8_t)i, SDL_Point{ 28 + column * 28 * 3, 28 + row * 28 * 3 }));
+					}
 				}
 
 				~MainScreen() {
@@ -193,7 +204,10 @@ namespace Gui {
 
 		public:
 			PixelPicker(SDL_Point startPos) {
-				Zone = SDL_Rect{ startPos.x, startPos.y, 500, 250 };
+				//grows downwards when the materials don't fit
+				int rows = ((int)Pxl::MaterialCount - 2) / BUTTONS_PER_ROW + 1;
+				Zone = SDL_Rect{ startPos.x, startPos.y, 500, std::max(250, 28 + rows * 28 * 3) };
+				Modal = true;
 
 				Maps.push_back(std::make_unique<MainScreen>(this));
 
@@ -242,10 +256,13 @@ namespace Gui {
 							mouseInGui = true;
 
 							for (int i = 0; i < Pxl::PIXELGRID_SIZE; i++) {
-								if (Pxl::GetPixel(i).Name != "Vacuum") {
-									Pxl::SetPixel( i, Pxl::PixelTypes[Pxl::types::VACUUM]);
+								if (Pxl::GetPixel(i).ID != Pxl::types::VACUUM) {
+									Pxl::SetPixel( i, Pxl::Pixel());
 								}
 							}
+							Pxl::ActiveWorld->FreeParticles.Clear();
+							Pxl::WakeAllChunks();
+							Pxl::ActiveWorld->EditCount++;
 						}
 					}
 				};
@@ -390,9 +407,217 @@ namespace Gui {
 			void Update(bool mouseClick, double deltaTime) {
 				Maps[currentMap]->Update(mouseClick, deltaTime);
 			}
+
+			//dropping down or folding up
+			bool IsAnimating() const { return ((MainScreen*)Maps[currentMap].get())->velocityY != 0; }
+		};
+
+		//CLASS: MINIMAP; the whole world small, with the camera's view and where the simulation is busy
+		class Minimap : public BaseGUI {
+		private:
+			//Screens
+			class MainScreen : public GuiMap {
+			private:
+				//the camera frame and hot spots drawn over the map, dragging on the map moves the camera
+				struct ViewportFrame : public GuiButton {
+					MainScreen* Parent;
+
+					bool isDragging = false;
+
+					ViewportFrame(MainScreen* parent) {
+						Parent = parent;
+
+						//makes invisible
+						useTexture = true;
+						Texture = NULL;
+					}
+
+					~ViewportFrame() {
+						Parent = nullptr;
+					}
+
+					void Update(bool mouseClick, double deltaTime) {
+						Zone = Parent->Parent->Zone;
+
+						if (isInsideRect(Zone, mPosition) && mouseClick) { isDragging = true; }
+						if (!(mButton & SDL_BUTTON_LMASK)) { isDragging = false; }
+						if (isDragging) {
+							mouseInGui = true;
+							Vector2 cell = Parent->ToCells(mPosition);
+							Pxl::View.CenterOn(cell.x, cell.y);
+						}
+					}
+
+					void Draw() {
+						Parent->DrawHotSpots();
+						Parent->DrawViewport();
+					}
+				};
+
+				Minimap* Parent;
+
+				//pyramid level the map is drawn from, the first that fits the widget
+				int Level = 0;
+				int TexelsWide = 0;
+				int TexelsHigh = 0;
+				std::vector<uint32_t> Buffer;
+				std::vector<size_t> Changed; //chunks the pyramid refreshed, reused every frame
+				std::vector<SDL_Rect> Dirty; //their texels
+				size_t ColorsFor = (size_t)-1; //MaterialsVersion the texture was drawn with
+
+			public:
+				MainScreen(Minimap* parent) {
+					Parent = parent;
+
+					Pxl::Overview.Update();
+					TexelsWide = (int)Pxl::PIXELGRID_WIDTH;
+					TexelsHigh = (int)Pxl::PIXELGRID_HEIGHT;
+					while (Level < Pxl::Overview.LevelCount() && (TexelsWide > Parent->Zone.w || TexelsHigh > Parent->Zone.h)) {
+						Level++;
+						TexelsWide = (int)Pxl::Overview.Get(Level).Width;
+						TexelsHigh = (int)Pxl::Overview.Get(Level).Height;
+					}
+					Buffer.resize((size_t)TexelsWide * TexelsHigh);
+
+					useTexture = true;
+					Texture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, TexelsWide, TexelsHigh);
+					SDL_SetTextureBlendMode(Texture, SDL_BLENDMODE_NONE);
+
+					Buttons.push_back(std::make_unique<ViewportFrame>(this));
+				}
+
+				~MainScreen() {
+				}
+
+				Vector2 ToCells(SDL_Point position) const {
+					const SDL_Rect& zone = Parent->Zone;
+					return Vector2{ (double)(position.x - zone.x) * Pxl::PIXELGRID_WIDTH / zone.w, (double)(position.y - zone.y) * Pxl::PIXELGRID_HEIGHT / zone.h };
+				}
+
+				//cells to widget pixels, clipped to the widget
+				SDL_Rect ToWidget(double x, double y, double w, double h) const {
+					const SDL_Rect& zone = Parent->Zone;
+					double scaleX = (double)zone.w / Pxl::PIXELGRID_WIDTH, scaleY = (double)zone.h / Pxl::PIXELGRID_HEIGHT;
+					int left = std::max(zone.x, zone.x + (int)std::floor(x * scaleX));
+					int top = std::max(zone.y, zone.y + (int)std::floor(y * scaleY));
+					int right = std::min(zone.x + zone.w, zone.x + (int)std::ceil((x + w) * scaleX));
+					int bottom = std::min(zone.y + zone.h, zone.y + (int)std::ceil((y + h) * scaleY));
+					return SDL_Rect{ left, top, std::max(0, right - left), std::max(0, bottom - top) };
+				}
+
+				//converts and uploads one rect of texels of the level
+				void Upload(const SDL_Rect& rect) {
+					Pxl::IdPlane plane = Pxl::PlaneAt(Level);
+					for (int y = 0; y < rect.h; y++) {
+						size_t first = rect.x + (rect.y + y) * plane.Width;
+						Pxl::Texels::ConvertRow(plane.Ids + first * plane.Stride, plane.Stride, plane.Variants + first, rect.w, Pxl::Palette::Colors[Pxl::Palette::NORMAL], &Buffer[(size_t)y * rect.w], 1, Pxl::Texels::Level);
+					}
+					SDL_UpdateTexture(Texture, &rect, Buffer.data(), rect.w * (int)sizeof(uint32_t));
+				}
+
+				//redraws the texels under chunks the pyramid refreshed since last time, all of them after a rebuild or a materials reload
+				void Refresh() {
+					Pxl::Overview.Update();
+					Pxl::Palette::Update();
+					bool all = Pxl::Overview.TakeChanged(Changed) || ColorsFor != Pxl::MaterialsVersion;
+					ColorsFor = Pxl::MaterialsVersion;
+					if (all) {
+						Upload(SDL_Rect{ 0, 0, TexelsWide, TexelsHigh });
+						return;
+					}
+
+					//each chunk's texels of the level, chunks smaller than a texel share theirs and go up once
+					int scale = 1 << Level;
+					Dirty.clear();
+					for (size_t chunk : Changed) {
+						int left = (int)(chunk % Pxl::CHUNKS_X * Pxl::CHUNK_SIZE), top = (int)(chunk / Pxl::CHUNKS_X * Pxl::CHUNK_SIZE);
+						SDL_Rect rect = SDL_Rect{ left / scale, top / scale, 0, 0 };
+						rect.w = std::min((left + (int)Pxl::CHUNK_SIZE + scale - 1) / scale, TexelsWide) - rect.x;
+						rect.h = std::min((top + (int)Pxl::CHUNK_SIZE + scale - 1) / scale, TexelsHigh) - rect.y;
+						Dirty.push_back(rect);
+					}
+					auto before = [](const SDL_Rect& a, const SDL_Rect& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; };
+					auto same = [](const SDL_Rect& a, const SDL_Rect& b) { return a.x == b.x && a.y == b.y; };
+					std::sort(Dirty.begin(), Dirty.end(), before);
+					Dirty.erase(std::unique(Dirty.begin(), Dirty.end(), same), Dirty.end());
+					for (const SDL_Rect& rect : Dirty) { Upload(rect); }
+				}
+
+				//awake chunks, grouped so a spot is at least HOT_SPOT_SIZE pixels across, brighter the more of them are awake
+				void DrawHotSpots() {
+					double chunkPixels = (double)Pxl::CHUNK_SIZE * Parent->Zone.w / Pxl::PIXELGRID_WIDTH;
+					size_t group = std::max<size_t>(1, (size_t)std::ceil(HOT_SPOT_SIZE / chunkPixels));
+
+					SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
+					for (size_t gy = 0; gy < Pxl::CHUNKS_Y; gy += group)
+					for (size_t gx = 0; gx < Pxl::CHUNKS_X; gx += group) {
+						size_t awake = 0, total = 0;
+						for (size_t cy = gy; cy < std::min(gy + group, Pxl::CHUNKS_Y); cy++)
+						for (size_t cx = gx; cx < std::min(gx + group, Pxl::CHUNKS_X); cx++) {
+							awake += Pxl::IsChunkAwake(cx, cy);
+							total++;
+						}
+						if (awake == 0) { continue; }
+
+						SDL_Rect spot = ToWidget((double)(gx * Pxl::CHUNK_SIZE), (double)(gy * Pxl::CHUNK_SIZE), (double)(group * Pxl::CHUNK_SIZE), (double)(group * Pxl::CHUNK_SIZE));
+						SDL_SetRenderDrawColor(gRenderer, 255, 60, 0, (Uint8)(40 + 120 * awake / total));
+						SDL_RenderFillRect(gRenderer, &spot);
+					}
+					SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_NONE);
+				}
+
+				void DrawViewport() {
+					Vector2 size = Pxl::View.ViewCells();
+					SDL_Rect frame = ToWidget(Pxl::View.X, Pxl::View.Y, size.x, size.y);
+					SDL_SetRenderDrawColor(gRenderer, 255, 255, 255, 255);
+					SDL_RenderDrawRect(gRenderer, &frame);
+				}
+
+				void Update(bool mouseClick, double deltaTime) {
+					for (int i = 0; i < Buttons.size(); i++) {
+						Buttons[i]->Update(mouseClick, deltaTime);
+					}
+					Refresh();
+				}
+			};
+
+		public:
+			//widget pixels
+			static const int MAX_SIZE = 200;
+			static const int HOT_SPOT_SIZE = 8;
+
+			//fits the world's shape into MAX_SIZE, startPos is the bottom left corner
+			Minimap(SDL_Point startPos) {
+				int width = MAX_SIZE, height = MAX_SIZE;
+				if (Pxl::PIXELGRID_WIDTH >= Pxl::PIXELGRID_HEIGHT) { height = std::max(1, (int)(MAX_SIZE * Pxl::PIXELGRID_HEIGHT / Pxl::PIXELGRID_WIDTH)); }
+				else { width = std::max(1, (int)(MAX_SIZE * Pxl::PIXELGRID_WIDTH / Pxl::PIXELGRID_HEIGHT)); }
+				Zone = SDL_Rect{ startPos.x, startPos.y - height, width, height };
+
+				Maps.push_back(std::make_unique<MainScreen>(this));
+
+				Update(false, 0);
+			}
+
+			void Update(bool mouseClick, double deltaTime) {
+				Maps[currentMap]->Update(mouseClick, deltaTime);
+			}
 		};
 	}
 
+	bool MouseOverGuis() {
+		for (const std::unique_ptr<BaseGUI>& gui : Guis) {
+			if (isInsideRect(gui->Zone, mPosition)) { return true; }
+		}
+		return false;
+	}
+
+	bool AnyAnimating() {
+		for (const std::unique_ptr<BaseGUI>& gui : Guis) {
+			if (gui->IsAnimating()) { return true; }
+		}
+		return false;
+	}
+
 	/*
 	returns:
 	* 0 if pixels should NOT be updated and mouse recognition should NOT be available
@@ -401,14 +626,18 @@ namespace Gui {
 	*/
 	int UpdateGuis(bool mouseClick, double deltaTime) {
 		int output;
-		bool shouldPixelsUpdate = Guis.size() < 2;
-		bool shouldMouseRecognition = !isInsideRect((Guis[Guis.size() - 1]->Zone), mPosition) && shouldPixelsUpdate;
+		bool shouldPixelsUpdate = !Guis.back()->Modal;
+		bool shouldMouseRecognition = !MouseOverGuis() && shouldPixelsUpdate;
 		if (!shouldPixelsUpdate && !shouldMouseRecognition) { output = 0; }
 		else if (shouldPixelsUpdate && !shouldMouseRecognition) { output = 1; }
 		else { output = 2; }
 		if ((mPosition.y < 0 || mPosition.y > SCREEN_HEIGHT) || (mPosition.x < 0 || mPosition.x > SCREEN_WIDTH) && output == 2) { output = 1; }
 
-		Guis[Guis.size() - 1]->Update(mouseClick, deltaTime);
+		//a modal gui on top gets all the input, otherwise every gui is live. guis opened here wait for the next frame
+		if (Guis.back()->Modal) { Guis.back()->Update(mouseClick, deltaTime); }
+		else {
+			for (size_t i = 0, count = Guis.size(); i < count; i++) { Guis[i]->Update(mouseClick, deltaTime); }
+		}
 		return output;
 	}
 
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "Pixel.h"
+
+/*
+* Reloads the materials file while the simulation runs.
+* A watcher thread waits for the file to change (inotify on linux, its modification time is polled elsewhere),
+* parses it and builds the reaction table, the main thread only swaps the result in between ticks.
+* Materials keep their ids by name so no cells have to be rewritten.
+*/
+namespace HotReload {
+
+	const int POLL_MS = 250;
+	const int SETTLE_MS = 50; //editors can save in several writes, waits for the last one
+
+	std::string Path;
+	std::thread Watcher;
+	std::atomic<bool> Running(false);
+
+	//ids the watcher hands out, what the simulation has once the pending set is swapped in. no reactions
+	Pxl::MaterialSet Current;
+
+	//filled by the watcher, taken by Apply
+	std::mutex PendingLock;
+	std::atomic<bool> HasPending(false);
+	Pxl::MaterialSet PendingSet;
+	std::vector<Pxl::Reaction> PendingTable;
+
+	//reorders a freshly parsed set so materials keep their current ids and new ones go at the end
+	//removed materials stay as they were, cells of them can still be in the world
+	bool KeepIds(Pxl::MaterialSet& set, std::string& error) {
+		std::vector<Pxl::Material> materials(Current.Materials);
+		std::vector<std::string> names(Current.Names);
+		std::vector<int> ids(set.Materials.size());
+		for (size_t i = 0; i < set.Materials.size(); i++) {
+			ids[i] = Pxl::FindMaterial(Current.Names, set.Names[i]);
+			if (ids[i] < 0) {
+				if (materials.size() == Pxl::MAX_MATERIALS) {
+					error = "more than 256 materials counting removed ones, restart to drop them";
+					return false;
+				}
+				ids[i] = (int)materials.size();
+				materials.push_back(Pxl::Material());
+				names.push_back(set.Names[i]);
+			}
+		}
+
+		for (size_t i = 0; i < set.Materials.size(); i++) {
+			Pxl::Material& material = set.Materials[i];
+			if (material.Heating.Into >= 0) { material.Heating.Into = ids[material.Heating.Into]; }
+			if (material.Cooling.Into >= 0) { material.Cooling.Into = ids[material.Cooling.Into]; }
+			materials[ids[i]] = material;
+		}
+		for (Pxl::ReactionRule& rule : set.Reactions) {
+			rule.A = ids[rule.A];
+			rule.B = ids[rule.B];
+			rule.ProductA = ids[rule.ProductA];
+			rule.ProductB = ids[rule.ProductB];
+		}
+
+		for (size_t id = 0; id < Current.Names.size(); id++) {
+			if (Pxl::FindMaterial(set.Names, Current.Names[id]) < 0) {
+				printf("%s was removed from %s, keeping it until restart\n", Current.Names[id].c_str(), Path.c_str());
+			}
+		}
+		set.Materials.swap(materials);
+		set.Names.swap(names);
+		return true;
+	}
+
+	//runs on the watcher thread, a file that doesn't parse leaves the current materials in place
+	void Reload() {
+		Pxl::MaterialSet set;
+		std::string error;
+		if (!Pxl::MaterialFile::Load(Path, set, error) || !KeepIds(set, error)) {
+			printf("materials not reloaded, %s\n", error.c_str());
+			return;
+		}
+		std::vector<Pxl::Reaction> table;
+		Pxl::BuildReactionTable(set, table);
+		Current.Materials = set.Materials;
+		Current.Names = set.Names;
+
+		//a newer file replaces a set that wasn't taken yet
+		std::lock_guard<std::mutex> lock(PendingLock);
+		PendingSet = std::move(set);
+		PendingTable.swap(table);
+		HasPending = true;
+	}
+
+#ifdef __linux__
+	//returns true if one of the events was for the materials file
+	bool ReadEvents(int fd, const std::string& name) {
+		alignas(inotify_event) char buffer[4096];
+		bool changed = false;
+		ssize_t length;
+		while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+			for (char* at = buffer; at < buffer + length;) {
+				const inotify_event* event = (const inotify_event*)at;
+				if (event->len > 0 && name == event->name) { changed = true; }
+				at += sizeof(inotify_event) + event->len;
+			}
+		}
+		return changed;
+	}
+
+	//watches the folder rather than the file, editors often save by replacing it
+	void Watch() {
+		size_t slash = Path.find_last_of('/');
+		std::string folder = slash == std::string::npos ? "." : Path.substr(0, slash);
+		std::string name = slash == std::string::npos ? Path : Path.substr(slash + 1);
+
+		int fd = inotify_init1(IN_NONBLOCK);
+		if (fd < 0 || inotify_add_watch(fd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+			printf("can't watch %s, materials won't reload\n", Path.c_str());
+			if (fd >= 0) { ::close(fd); }
+			return;
+		}
+
+		while (Running) {
+			pollfd request = { fd, POLLIN, 0 };
+			if (poll(&request, 1, POLL_MS) <= 0 || !ReadEvents(fd, name)) { continue; }
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MS));
+			ReadEvents(fd, name);
+			Reload();
+		}
+		::close(fd);
+	}
+#else
+	//size as well, the time is only in seconds
+	std::pair<time_t, long long> FileStamp() {
+		struct stat info;
+		if (stat(Path.c_str(), &info) != 0) { return std::make_pair((time_t)0, 0LL); }
+		return std::make_pair(info.st_mtime, (long long)info.st_size);
+	}
+
+	void Watch() {
+		std::pair<time_t, long long> last = FileStamp();
+		while (Running) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+			std::pair<time_t, long long> stamp = FileStamp();
+			if (stamp == last || stamp.first == 0) { continue; }
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MS));
+			last = FileStamp();
+			Reload();
+		}
+	}
+#endif
+
+	//call after the materials are loaded
+	void Start(const std::string& path) {
+		Path = path;
+		Current.Materials.assign(Pxl::Materials, Pxl::Materials + Pxl::MaterialCount);
+		Current.Names.assign(Pxl::MaterialNames, Pxl::MaterialNames + Pxl::MaterialCount);
+		Running = true;
+		Watcher = std::thread(Watch);
+	}
+
+	void Stop() {
+		Running = false;
+		if (Watcher.joinable()) { Watcher.join(); }
+	}
+
+	//main thread, between ticks. returns true if new materials went in
+	bool Apply() {
+		if (!HasPending) { return false; }
+		//the watcher only holds the lock for a swap, trying again next tick is fine
+		std::unique_lock<std::mutex> lock(PendingLock, std::try_to_lock);
+		if (!lock.owns_lock()) { return false; }
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		Pxl::SwapMaterials(PendingSet, PendingTable);
+		HasPending = false;
+		double micros = (double)(SDL_GetPerformanceCounter() - start) * 1e6 / (double)SDL_GetPerformanceFrequency();
+
+		//sleeping cells have to see the new densities and phase points too
+		Pxl::WakeAllChunks();
+		std::fill(Pxl::ActiveWorld->ChunkHeatAwake, Pxl::ActiveWorld->ChunkHeatAwake + Pxl::CHUNKS_X * Pxl::CHUNKS_Y, true);
+		//cells already past a moved phase point change without waiting for their temperature to
+		for (size_t i = 0; i < Pxl::PIXELGRID_SIZE; i++) {
+			if (Pxl::DuePhaseChange(Pxl::ActiveWorld->Pixels[i]) != nullptr) { Pxl::ActiveWorld->PendingPhaseChanges.push_back(i); }
+		}
+		//the audit starts over, the number of materials can change
+		Pxl::ActiveWorld->EditCount++;
+
+		printf("reloaded %s, %zu materials, swapped in %.1f us\n", Path.c_str(), Pxl::MaterialCount, micros);
+		return true;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+* Margolus block rules. The grid is cut into 2x2 blocks, shifted by one cell every other tick,
+* and each block is rearranged on its own from the classes of its four cells.
+* Slots are 0 top left, 1 top right, 2 bottom left, 3 bottom right.
+* A table entry is a permutation, slot d receives the cell that was in slot (entry >> 2d) & 3,
+* so a block can only move cells around and never creates or destroys one.
+*/
+namespace Pxl {
+	namespace Margolus {
+
+		//ordered by weight, a heavier cell sinks through a lighter one, SOLID never moves
+		enum Classes {
+			LIGHT_GAS,
+			EMPTY,
+			HEAVY_GAS,
+			LIQUID,
+			POWDER,
+			SOLID,
+			CLASS_COUNT
+		};
+
+		const size_t BLOCK_KEYS = CLASS_COUNT * CLASS_COUNT * CLASS_COUNT * CLASS_COUNT;
+		const uint8_t IDENTITY = 0 | 1 << 2 | 2 << 4 | 3 << 6;
+
+		//second index is a random bit per block, it picks the side for toppling and lets fluids spread
+		uint8_t Table[2][BLOCK_KEYS];
+
+		size_t BlockKey(int topLeft, int topRight, int bottomLeft, int bottomRight) {
+			return ((topLeft * CLASS_COUNT + topRight) * CLASS_COUNT + bottomLeft) * CLASS_COUNT + bottomRight;
+		}
+
+		bool IsFluid(int cls) { return cls == LIGHT_GAS || cls == HEAVY_GAS || cls == LIQUID; }
+
+		//the same rules as the per-cell path, cut down to what a block can see
+		uint8_t BlockRule(const int classes[4], int variant) {
+			int source[4] = { 0, 1, 2, 3 };
+			bool moved[4] = {};
+			auto cls = [&](int slot) { return classes[source[slot]]; };
+			//the cell in slot from sinks into slot to
+			auto sinks = [&](int from, int to) { return cls(from) != SOLID && cls(to) != SOLID && cls(from) > cls(to); };
+			auto swap = [&](int a, int b) {
+				int held = source[a];
+				source[a] = source[b];
+				source[b] = held;
+				moved[a] = moved[b] = true;
+			};
+
+			//fall straight down, or rise for gases lighter than air
+			for (int column = 0; column < 2; column++) {
+				if (sinks(column, column + 2)) { swap(column, column + 2); }
+			}
+
+			//what couldn't fall topples diagonally, the variant picks which top cell goes first
+			for (int i = 0; i < 2; i++) {
+				int top = variant ? i : 1 - i;
+				int diagonal = top == 0 ? 3 : 2;
+				if (!moved[top] && cls(top) >= HEAVY_GAS && !sinks(top, top + 2) && sinks(top, diagonal)) { swap(top, diagonal); }
+			}
+
+			//fluids swap sideways with anything lighter than a liquid, half of the time
+			if (variant) {
+				for (int row = 0; row < 4; row += 2) {
+					int a = cls(row);
+					int b = cls(row + 1);
+					if (a != b && (IsFluid(a) || IsFluid(b)) && a <= LIQUID && b <= LIQUID && !moved[row] && !moved[row + 1]) { swap(row, row + 1); }
+				}
+			}
+
+			return (uint8_t)(source[0] | source[1] << 2 | source[2] << 4 | source[3] << 6);
+		}
+
+		void BuildTable() {
+			for (int variant = 0; variant < 2; variant++)
+			for (int a = 0; a < CLASS_COUNT; a++)
+			for (int b = 0; b < CLASS_COUNT; b++)
+			for (int c = 0; c < CLASS_COUNT; c++)
+			for (int d = 0; d < CLASS_COUNT; d++) {
+				const int classes[4] = { a, b, c, d };
+				Table[variant][BlockKey(a, b, c, d)] = BlockRule(classes, variant);
+			}
+		}
+	}
+}
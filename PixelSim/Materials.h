@@ -0,0 +1,231 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+/*
+* Material definitions and the parser for the materials file.
+* One [Name] block per material followed by "key = value" lines, ids are handed out in file
+* order, so Vacuum has to come first. Materials can refer to ones defined further down.
+*/
+namespace Pxl {
+
+	//in degrees celsius, what every cell starts at
+	const float ROOM_TEMPERATURE = 20.0f;
+
+	//ids are 8 bit
+	const size_t MAX_MATERIALS = 256;
+	//names live in their own fixed size table so the materials stay plain data
+	const size_t MAX_NAME_LENGTH = 31;
+
+	namespace types {
+		//the only material the code relies on, the rest comes from the materials file
+		const uint8_t VACUUM = 0;
+
+		enum Phases {
+			SOLID_STATIC,
+			SOLID_POWDER,
+			LIQUID,
+			GAS
+		};
+	}
+
+	//crossing Point by LatentHeat turns a cell into Into, it comes out at Point so the latent heat is used up
+	struct PhaseChange {
+		float Point = 0.0f;
+		int Into = -1; //-1 if there is no such change
+		float LatentHeat = 0.0f;
+	};
+
+	struct RGBA {
+		uint8_t r, g, b, a;
+	};
+
+	//everything about a material but its name, cells only store its id
+	struct Material {
+		//read per cell by the kernels, kept together at the front
+		int Phase = types::GAS;
+		int DispersionRate = 0; //how many cells a liquid can flow sideways in one tick
+		float Density = 0.0f; //weight of a full cell, decides what sinks through what
+		float AtomMass = 0.0f; //per mole, decides whether a gas rises or sinks
+		float Conductivity = 0.0f; //share of the temperature difference to a neighbour that flows over each heat step, at most 0.25
+		PhaseChange Heating; //melting, boiling
+		PhaseChange Cooling; //freezing, condensing
+
+		float SpawnTemperature = ROOM_TEMPERATURE; //what new cells start at
+		RGBA Color = RGBA{ 50,50,50,255 };
+		int ColorVariance = 0; //cells are up to this much lighter or darker
+		uint8_t Padding[8] = {}; //to a whole cache line, the table is aligned to them so a lookup touches one
+	};
+	static_assert(std::is_trivially_copyable<Material>::value, "materials are copied and swapped as plain data");
+	static_assert(sizeof(Material) == 64, "a material should fill exactly one cache line");
+
+	struct ReactionRule {
+		int A;
+		int B;
+		int ProductA;
+		int ProductB;
+		float Probability;
+		float Energy;
+	};
+
+	struct MaterialSet {
+		std::vector<Material> Materials;
+		std::vector<std::string> Names; //same order as Materials
+		std::vector<ReactionRule> Reactions;
+	};
+
+	int FindMaterial(const std::vector<std::string>& names, const std::string& name) {
+		for (size_t i = 0; i < names.size(); i++) {
+			if (names[i] == name) { return (int)i; }
+		}
+		return -1;
+	}
+
+	namespace MaterialFile {
+
+		std::string Trim(const std::string& text) {
+			size_t start = text.find_first_not_of(" \t\r\n");
+			if (start == std::string::npos) { return ""; }
+			return text.substr(start, text.find_last_not_of(" \t\r\n") - start + 1);
+		}
+
+		//names are only known once the whole file is read
+		struct PendingName {
+			size_t Line;
+			std::string Name;
+			size_t Index; //material or reaction
+			int Field;
+		};
+
+		enum PendingFields { HEATING_INTO, COOLING_INTO, REACTION_B, REACTION_PRODUCT_A, REACTION_PRODUCT_B };
+
+		int& NameTarget(MaterialSet& set, const PendingName& name) {
+			switch (name.Field) {
+			case HEATING_INTO: return set.Materials[name.Index].Heating.Into;
+			case COOLING_INTO: return set.Materials[name.Index].Cooling.Into;
+			case REACTION_B: return set.Reactions[name.Index].B;
+			case REACTION_PRODUCT_A: return set.Reactions[name.Index].ProductA;
+			default: return set.Reactions[name.Index].ProductB;
+			}
+		}
+
+		bool ParsePhase(const std::string& value, int& phase) {
+			const char* names[4] = { "static", "powder", "liquid", "gas" };
+			for (int i = 0; i < 4; i++) {
+				if (value == names[i]) {
+					phase = i;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool Fail(std::string& error, size_t line, const std::string& message) {
+			error = "line " + std::to_string(line) + ": " + message;
+			return false;
+		}
+
+		bool Parse(std::istream& in, MaterialSet& set, std::string& error) {
+			set = MaterialSet();
+			std::vector<PendingName> names;
+			std::string text;
+			size_t line = 0;
+
+			while (std::getline(in, text)) {
+				line++;
+				text = Trim(text.substr(0, text.find('#')));
+				if (text.empty()) { continue; }
+
+				if (text.front() == '[') {
+					if (text.back() != ']') { return Fail(error, line, "missing ]"); }
+					if (set.Materials.size() == MAX_MATERIALS) { return Fail(error, line, "more than 256 materials"); }
+					set.Materials.push_back(Material());
+					set.Names.push_back(Trim(text.substr(1, text.size() - 2)));
+					if (set.Names.back().size() > MAX_NAME_LENGTH) { return Fail(error, line, "names can be at most 31 characters"); }
+					if (FindMaterial(set.Names, set.Names.back()) != (int)set.Names.size() - 1) {
+						return Fail(error, line, "material " + set.Names.back() + " is defined twice");
+					}
+					continue;
+				}
+
+				size_t equals = text.find('=');
+				if (equals == std::string::npos) { return Fail(error, line, "expected key = value"); }
+				if (set.Materials.empty()) { return Fail(error, line, "value outside of a [Material] block"); }
+
+				Material& material = set.Materials.back();
+				std::string key = Trim(text.substr(0, equals));
+				std::istringstream value(Trim(text.substr(equals + 1)));
+				bool ok = true;
+
+				if (key == "phase") {
+					ok = ParsePhase(value.str(), material.Phase);
+				}
+				else if (key == "color") {
+					int r, g, b;
+					ok = (bool)(value >> r >> g >> b);
+					if (ok && (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)) { return Fail(error, line, "color channels have to be between 0 and 255"); }
+					material.Color = RGBA{ (uint8_t)r, (uint8_t)g, (uint8_t)b, 255 };
+				}
+				else if (key == "variance") { ok = (bool)(value >> material.ColorVariance); }
+				else if (key == "density") { ok = (bool)(value >> material.Density); }
+				else if (key == "atommass") { ok = (bool)(value >> material.AtomMass); }
+				else if (key == "dispersion") { ok = (bool)(value >> material.DispersionRate); }
+				else if (key == "conductivity") {
+					ok = (bool)(value >> material.Conductivity);
+					if (ok && (material.Conductivity < 0 || material.Conductivity > 0.25f)) { return Fail(error, line, "conductivity has to be between 0 and 0.25"); }
+				}
+				else if (key == "temperature") { ok = (bool)(value >> material.SpawnTemperature); }
+				else if (key == "heating" || key == "cooling") {
+					//point, material, latent heat
+					PhaseChange& change = key == "heating" ? material.Heating : material.Cooling;
+					std::string into;
+					ok = (bool)(value >> change.Point >> into >> change.LatentHeat);
+					names.push_back(PendingName{ line, into, set.Materials.size() - 1, key == "heating" ? HEATING_INTO : COOLING_INTO });
+				}
+				else if (key == "react") {
+					//other material, what this one becomes, what the other one becomes, probability, energy
+					std::string other, product, otherProduct;
+					ReactionRule rule = { (int)set.Materials.size() - 1, -1, -1, -1, 0.0f, 0.0f };
+					ok = (bool)(value >> other >> product >> otherProduct >> rule.Probability >> rule.Energy);
+					if (ok && rule.Probability < 0) { return Fail(error, line, "probability can't be negative"); }
+					set.Reactions.push_back(rule);
+					names.push_back(PendingName{ line, other, set.Reactions.size() - 1, REACTION_B });
+					names.push_back(PendingName{ line, product, set.Reactions.size() - 1, REACTION_PRODUCT_A });
+					names.push_back(PendingName{ line, otherProduct, set.Reactions.size() - 1, REACTION_PRODUCT_B });
+				}
+				else {
+					return Fail(error, line, "unknown key " + key);
+				}
+
+				if (!ok) { return Fail(error, line, "bad value for " + key); }
+			}
+
+			if (set.Materials.empty() || set.Names[0] != "Vacuum") { return Fail(error, 1, "the first material has to be Vacuum"); }
+
+			for (size_t i = 0; i < names.size(); i++) {
+				int& target = NameTarget(set, names[i]);
+				target = FindMaterial(set.Names, names[i].Name);
+				if (target < 0) { return Fail(error, names[i].Line, "unknown material " + names[i].Name); }
+			}
+			return true;
+		}
+
+		bool Load(const std::string& path, MaterialSet& set, std::string& error) {
+			std::ifstream file(path);
+			if (!file) {
+				error = "can't open " + path;
+				return false;
+			}
+			if (!Parse(file, set, error)) {
+				error = path + " " + error;
+				return false;
+			}
+			return true;
+		}
+	}
+}
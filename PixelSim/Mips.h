@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "Pixel.h"
+
+/*
+* The world's material ids at 1/2, 1/4, 1/8... size, every cell of a level holds the most common id of the four below it.
+* Vacuum loses ties so thin layers of material don't disappear when zoomed out.
+* Update keeps it in step from the chunks that were awake or woken, which is every chunk a tick or the brush changed.
+*/
+namespace Pxl {
+	namespace Mips {
+
+		const int MAX_LEVELS = 8;
+
+		struct Level {
+			size_t Width = 0;
+			size_t Height = 0;
+			std::vector<uint8_t> Ids;
+
+			uint8_t At(size_t x, size_t y) const { return Ids[x + y * Width]; }
+		};
+
+		uint8_t Majority(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+			if (a == b && a == c && a == d) { return a; }
+			const uint8_t ids[4] = { a, b, c, d };
+			uint8_t best = a;
+			int bestCount = 0;
+			for (int i = 0; i < 4; i++) {
+				int count = (ids[i] == a) + (ids[i] == b) + (ids[i] == c) + (ids[i] == d);
+				if (count > bestCount || (count == bestCount && best == types::VACUUM)) {
+					best = ids[i];
+					bestCount = count;
+				}
+			}
+			return best;
+		}
+
+		class Pyramid {
+		public:
+			//level 1 is half the world's size, level 0 is the world itself and not stored
+			const Level& Get(int level) const { return Levels[level - 1]; }
+			int LevelCount() const { return (int)Levels.size(); }
+
+			/* Hands over the chunks refreshed since the last call, each one once, for a single reader that mirrors the pyramid.
+			* Returns true instead when it was rebuilt as a whole, chunks is left empty then */
+			bool TakeChanged(std::vector<size_t>& chunks) {
+				chunks.clear();
+				chunks.swap(Changed);
+				for (size_t chunk : chunks) { IsChanged[chunk] = false; }
+				bool all = ChangedAll;
+				ChangedAll = false;
+				return all;
+			}
+
+			/* Call once per tick or more. Nothing to do when no tick ran and nothing was painted since the last call,
+			* a world it wasn't last updated from or skipped ticks rebuild it all */
+			void Update() {
+				if (Levels.empty()) { Allocate(); }
+				World* world = ActiveWorld;
+				if (world == BuiltFrom && world->Tick == BuiltTick && world->EditCount == BuiltEdits) { return; }
+				if (world != BuiltFrom || world->Tick < BuiltTick || world->Tick > BuiltTick + 1) {
+					for (int level = 1; level <= LevelCount(); level++) { Rebuild(level, 0, 0, Get(level).Width, Get(level).Height); }
+					for (size_t chunk : Changed) { IsChanged[chunk] = false; }
+					Changed.clear();
+					ChangedAll = true;
+				}
+				else {
+					for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+					for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+						size_t chunk = cx + cy * CHUNKS_X;
+						if (!world->ChunkAwake[chunk] && !world->ChunkAwakeNext[chunk]) { continue; }
+						if (!ChangedAll && !IsChanged[chunk]) {
+							IsChanged[chunk] = true;
+							Changed.push_back(chunk);
+						}
+
+						//the chunk's cells and then every block above them
+						size_t left = cx * CHUNK_SIZE, top = cy * CHUNK_SIZE;
+						size_t right = std::min(left + CHUNK_SIZE, PIXELGRID_WIDTH), bottom = std::min(top + CHUNK_SIZE, PIXELGRID_HEIGHT);
+						for (int level = 1; level <= LevelCount(); level++) {
+							left >>= 1;
+							top >>= 1;
+							right = (right + 1) >> 1;
+							bottom = (bottom + 1) >> 1;
+							Rebuild(level, left, top, right, bottom);
+						}
+					}
+				}
+				BuiltFrom = world;
+				BuiltTick = world->Tick;
+				BuiltEdits = world->EditCount;
+			}
+
+		private:
+			std::vector<Level> Levels;
+			World* BuiltFrom = nullptr;
+			size_t BuiltTick = 0;
+			size_t BuiltEdits = 0;
+			std::vector<size_t> Changed; //since the last TakeChanged
+			std::vector<bool> IsChanged = std::vector<bool>(CHUNKS_X * CHUNKS_Y);
+			bool ChangedAll = false;
+
+			//halves until a level would be a single row or column
+			void Allocate() {
+				size_t width = PIXELGRID_WIDTH, height = PIXELGRID_HEIGHT;
+				while ((int)Levels.size() < MAX_LEVELS && width > 1 && height > 1) {
+					width = (width + 1) / 2;
+					height = (height + 1) / 2;
+					Levels.emplace_back();
+					Levels.back().Width = width;
+					Levels.back().Height = height;
+					Levels.back().Ids.resize(width * height);
+				}
+			}
+
+			//blocks on an odd edge repeat their last row or column
+			void Rebuild(int level, size_t left, size_t top, size_t right, size_t bottom) {
+				const uint8_t* ids = &ActiveWorld->Pixels[0].ID;
+				size_t stride = sizeof(Pixel), width = PIXELGRID_WIDTH, height = PIXELGRID_HEIGHT;
+				if (level > 1) {
+					const Level& below = Get(level - 1);
+					ids = below.Ids.data();
+					stride = 1;
+					width = below.Width;
+					height = below.Height;
+				}
+
+				Level& target = Levels[level - 1];
+				for (size_t y = top; y < bottom; y++) {
+					const uint8_t* upper = ids + 2 * y * width * stride;
+					const uint8_t* lower = ids + std::min(2 * y + 1, height - 1) * width * stride;
+					for (size_t x = left; x < right; x++) {
+						size_t first = 2 * x * stride, second = std::min(2 * x + 1, width - 1) * stride;
+						target.Ids[x + y * target.Width] = Majority(upper[first], upper[second], lower[first], lower[second]);
+					}
+				}
+			}
+		};
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/*
+* Holds the loop to a fixed frame rate on the performance counter. A wait sleeps in whole milliseconds until SPIN_MS
+* before the deadline and spins for the rest, SDL_Delay alone can oversleep by a millisecond or more.
+* With vsync on the present does the waiting instead. The last frame times are kept to report how even they are,
+* steady frames matter more than the average.
+*/
+namespace Pacer {
+
+	//left to spin, the most SDL_Delay is expected to overshoot by
+	const double SPIN_MS = 2.0;
+	//frames the statistics are taken over
+	const size_t WINDOW = 300;
+
+	struct FrameStats {
+		double MeanMs = 0;
+		double DeviationMs = 0; //standard deviation
+		double MinMs = 0;
+		double MaxMs = 0;
+	};
+
+	class FramePacer {
+	public:
+		FramePacer(int fps) : Frequency(SDL_GetPerformanceFrequency()) {
+			Period = Frequency / fps;
+			Restart();
+		}
+
+		bool IsVSync() const { return VSync; }
+
+		//the renderer has to support it, false if it doesn't
+		bool SetVSync(SDL_Renderer* renderer, bool on) {
+			if (SDL_RenderSetVSync(renderer, on ? 1 : 0) != 0) { return false; }
+			VSync = on;
+			Restart();
+			return true;
+		}
+
+		//call right after presenting, returns when the next frame should start
+		void EndFrame() {
+			if (!VSync) { Wait(); }
+			Uint64 now = SDL_GetPerformanceCounter();
+			if (SkipSample) { SkipSample = false; }
+			else { Record((double)(now - LastFrame) * 1000.0 / (double)Frequency); }
+			LastFrame = now;
+		}
+
+		//after time that wasn't spent on frames, the schedule starts over from now and the gap isn't counted
+		void Restart() {
+			LastFrame = SDL_GetPerformanceCounter();
+			Deadline = LastFrame;
+			SkipSample = true;
+		}
+
+		//over the last WINDOW frames
+		FrameStats Stats() const {
+			FrameStats stats;
+			if (Samples.empty()) { return stats; }
+			double sum = 0;
+			stats.MinMs = Samples[0];
+			stats.MaxMs = Samples[0];
+			for (double ms : Samples) {
+				sum += ms;
+				stats.MinMs = std::min(stats.MinMs, ms);
+				stats.MaxMs = std::max(stats.MaxMs, ms);
+			}
+			stats.MeanMs = sum / Samples.size();
+			double squares = 0;
+			for (double ms : Samples) { squares += (ms - stats.MeanMs) * (ms - stats.MeanMs); }
+			stats.DeviationMs = std::sqrt(squares / Samples.size());
+			return stats;
+		}
+
+	private:
+		Uint64 Frequency;
+		Uint64 Period; //counter ticks per frame
+		Uint64 Deadline = 0;
+		Uint64 LastFrame = 0;
+		bool SkipSample = true;
+		bool VSync = false;
+		std::vector<double> Samples;
+		size_t NextSample = 0;
+
+		void Record(double ms) {
+			if (Samples.size() < WINDOW) { Samples.push_back(ms); }
+			else { Samples[NextSample] = ms; }
+			NextSample = (NextSample + 1) % WINDOW;
+		}
+
+		/* Deadlines follow each other a period apart so rounding doesn't add up,
+		* a frame more than a period late starts a new schedule instead of rushing the next ones */
+		void Wait() {
+			Deadline += Period;
+			Uint64 now = SDL_GetPerformanceCounter();
+			if (now >= Deadline) {
+				if (now - Deadline > Period) { Deadline = now; }
+				return;
+			}
+
+			double remainingMs = (double)(Deadline - now) * 1000.0 / (double)Frequency;
+			while (remainingMs > SPIN_MS) {
+				SDL_Delay((Uint32)(remainingMs - SPIN_MS));
+				now = SDL_GetPerformanceCounter();
+				remainingMs = now < Deadline ? (double)(Deadline - now) * 1000.0 / (double)Frequency : 0;
+			}
+			while (SDL_GetPerformanceCounter() < Deadline) {}
+		}
+	};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+/*
+* Airborne material lives here instead of in the grid. Positions and velocities are kept
+* as separate arrays so Integrate is one flat loop the compiler can vectorise, the payload
+* (whatever the cell was when it got lifted) is only touched on lift and deposit.
+*/
+namespace Pxl {
+	namespace Particles {
+
+		template <typename Payload>
+		class ParticleBuffer {
+		public:
+			//positions are in cells, x + 0.5 is the middle of cell x
+			std::vector<float> X;
+			std::vector<float> Y;
+			std::vector<float> VelocityX;
+			std::vector<float> VelocityY;
+			std::vector<Payload> Payloads;
+
+			size_t Size() const { return X.size(); }
+
+			void Add(float x, float y, float vx, float vy, const Payload& payload) {
+				X.push_back(x);
+				Y.push_back(y);
+				VelocityX.push_back(vx);
+				VelocityY.push_back(vy);
+				Payloads.push_back(payload);
+			}
+
+			//swaps the last particle into the slot, order doesn't matter
+			void Remove(size_t i) {
+				size_t last = Size() - 1;
+				X[i] = X[last];
+				Y[i] = Y[last];
+				VelocityX[i] = VelocityX[last];
+				VelocityY[i] = VelocityY[last];
+				Payloads[i] = Payloads[last];
+
+				X.pop_back();
+				Y.pop_back();
+				VelocityX.pop_back();
+				VelocityY.pop_back();
+				Payloads.pop_back();
+			}
+
+			void Clear() {
+				X.clear();
+				Y.clear();
+				VelocityX.clear();
+				VelocityY.clear();
+				Payloads.clear();
+			}
+
+			//one tick of free flight, collisions are handled by the caller afterwards
+			void Integrate(float gravity, float maxVelocity, float drag) {
+				const size_t count = Size();
+				float* x = X.data();
+				float* y = Y.data();
+				float* vx = VelocityX.data();
+				float* vy = VelocityY.data();
+
+				for (size_t i = 0; i < count; i++) {
+					vx[i] *= drag;
+					vy[i] = std::min(vy[i] + gravity, maxVelocity);
+					x[i] += vx[i];
+					y[i] += vy[i];
+				}
+			}
+		};
+	}
+}
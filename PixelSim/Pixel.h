@@ -1,99 +1,67 @@
 #pragma once
 
-#include <SDL.h>
 #include <stdio.h>
 #include <string>
 #include <vector>
-#include <SDL_image.h>
-#include <iostream>
-
-
 #include <algorithm>
-
-#include "Helper.h"
-
+#include <cmath>
+#include <stdint.h>
+
+#include "Vector2.h"
+#include "Bitboard.h"
+#include "Margolus.h"
+#include "Particles.h"
+#include "Materials.h"
+
+//world size in cells, the game sets it from the window, the core library takes it from the build
+#ifndef PXL_GRID_WIDTH
+#define PXL_GRID_WIDTH 160
+#endif
+#ifndef PXL_GRID_HEIGHT
+#define PXL_GRID_HEIGHT 120
+#endif
+
+/*
+* The simulation core, nothing in here draws or needs SDL.
+* The game wraps it in Game.h and the C API in PixelSimCore.h wraps it for other programs.
+*/
 namespace Pxl {
 
-	const size_t PIXELGRID_SIZE = SCREEN_WIDTH * SCREEN_HEIGHT / PIXEL_SIZE;
-	const size_t PIXELGRID_WIDTH = SCREEN_WIDTH / PIXEL_SIZE;
-	const size_t PIXELGRID_HEIGHT = SCREEN_HEIGHT / PIXEL_SIZE;
+	const size_t PIXELGRID_WIDTH = PXL_GRID_WIDTH;
+	const size_t PIXELGRID_HEIGHT = PXL_GRID_HEIGHT;
+	const size_t PIXELGRID_SIZE = PIXELGRID_WIDTH * PIXELGRID_HEIGHT;
 
-	namespace types {
-		enum PixelTypesID {
-			VACUUM,
-			WATER,
-			SAND,
-			STONE,
-		};
+	//moles are fixed point, a full cell holds this many units
+	const uint16_t MOLES_PER_PIXEL = 1024;
 
-		enum Phases {
-			SOLID_STATIC,
-			SOLID_POWDER,
-			LIQUID,
-			GAS
-		};
-	}
+	//---MATERIALS---
+	//installed from the materials file, kernels index it with the cell's id
+	alignas(64) Material Materials[MAX_MATERIALS];
+	char MaterialNames[MAX_MATERIALS][MAX_NAME_LENGTH + 1];
+	size_t MaterialCount = 0;
+	size_t MaterialsVersion = 0; //bumped whenever materials are installed, for anything built from them
 
 	class Pixel {
 	public:
-		//type related
-
-		int ID = 0;
-		std::string Name;
-		SDL_Color Color = SDL_Color{ 50,50,50,255 };
-		float AtomMass = 0.0f;
-
-		//non-type related
-
-		int Phase = types::GAS;
+		uint8_t ID = types::VACUUM;
 		bool Updated = false;
-		float Moles = 0;
+		uint16_t Moles = 0;
 		Vector2 Velocity = {0,0};
-		int Temperature = 0;
-		int colOff = 0;
+		float Temperature = ROOM_TEMPERATURE;
 
-		float GetMass() {
-			return Moles * AtomMass;
+		const Material& Type() const { return Materials[ID]; }
+
+		float GetMass() const {
+			return (float)Moles / MOLES_PER_PIXEL * Type().Density;
 		}
 	};
 
-	//---PIXEL TYPES---
-	const Pixel PixelTypes[4] = {
-		//VACUUM
-		Pixel{
-			types::VACUUM,
-			"Vacuum",
-			SDL_Color{ 50,50,50 },
-			0.0f
-		},
-
-		//WATER
-		Pixel{
-			types::WATER,
-			"Water",
-			SDL_Color{ 170,170,200 },
-			16.0f,
-			types::LIQUID
-		},
-
-		//SAND
-		Pixel{
-			types::SAND,
-			"Sand",
-			SDL_Color{ 200,200,170 },
-			60.1f,
-			types::SOLID_POWDER
-		},
-
-		//Stone
-		Pixel{
-			types::STONE,
-			"Stone",
-			SDL_Color{ 100,100,130 },
-			0.0f,
-			types::SOLID_STATIC
-		},
-	};
+	int FindMaterial(const std::string& name) {
+		for (size_t i = 0; i < MaterialCount; i++) {
+			if (name == MaterialNames[i]) { return (int)i; }
+		}
+		return -1;
+	}
 
 	enum class PixelMoveTypes : size_t {
 		SWAP,
@@ -102,27 +70,132 @@ namespace Pxl {
 		INJECT
 	};
 
-	Pixel Pixels[PIXELGRID_SIZE];
+	//---WORLD---
+	//only awake chunks get updated, a chunk stays awake as long as something in or next to it changes
+	const size_t CHUNK_SIZE = 16;
+	const size_t CHUNKS_X = (PIXELGRID_WIDTH + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	const size_t CHUNKS_Y = (PIXELGRID_HEIGHT + CHUNK_SIZE - 1) / CHUNK_SIZE;
 
-	const Pixel& GetPixel(size_t pos) { return Pixels[pos]; }
-	const Pixel& GetPixel(size_t x, size_t y) { return Pixels[x + y * PIXELGRID_WIDTH]; }
+	struct PixelMoveRequest {
+		size_t StartIndex;
+		size_t EndIndex;
+		size_t Type;
+		double Velocity = -1; //falls only, the cell's fall speed once the move is committed. negative leaves it alone
+	};
+
+	struct ReactionRequest {
+		size_t IndexA;
+		size_t IndexB;
+		int IdA;
+		int IdB;
+	};
+
+	/* Everything one simulation owns. The functions in Pxl work on the world active on the calling
+	* thread, so worlds on different threads can be stepped at the same time.
+	* Materials are shared between worlds and only change between ticks */
+	struct World {
+		Pixel Pixels[PIXELGRID_SIZE];
+		uint8_t Ids[PIXELGRID_SIZE] = {}; //one byte per cell for readers that only want ids, ticks don't keep it current, PackIds does
+
+		size_t Tick = 0; //unpaused ticks so far
+		size_t EditCount = 0; //bumped whenever material is added or removed on purpose (brush, clearing), the mass audit starts over
+		int64_t MolesConverted[MAX_MATERIALS] = {}; //net moles each material gained from phase changes and reactions, so the mass audit can tell them from leaks
+		uint64_t RandomState = 0x9E3779B97F4A7C15ull;
+
+		//which path StepTick takes, the engines set these
+		bool UseBitboardKernel = false;
+		bool UseSpecialisedKernels = true;
+		bool UseMargolus = false;
+
+		bool ChunkAwake[CHUNKS_X * CHUNKS_Y] = {}; //updated this tick
+		bool ChunkAwakeNext[CHUNKS_X * CHUNKS_Y] = {}; //woken by changes, updated next tick
+		bool ChunkHeatAwake[CHUNKS_X * CHUNKS_Y] = {};
+		bool ChunkHeatAwakeNext[CHUNKS_X * CHUNKS_Y] = {};
+
+		//filled and emptied within a tick
+		std::vector<PixelMoveRequest> PixelChangesBuffer; // (1)ending pixel <- (2)starting pixel
+		std::vector<size_t> PendingLifts; //cells MovePixelFall wants lifted once the scan is done
+		std::vector<size_t> PendingPhaseChanges; //cells the last heat step pushed over a transition
+		std::vector<ReactionRequest> PendingReactions;
+
+		Particles::ParticleBuffer<Pixel> FreeParticles;
+	};
+
+	//what the game shows, other worlds are for validation and batch runs
+	World MainWorld;
+	thread_local World* ActiveWorld = &MainWorld;
+
+	void SetActiveWorld(World& world) { ActiveWorld = &world; }
+
+	//xorshift on the active world's state, worlds on different threads don't share a sequence
+	uint32_t Random() { return (uint32_t)(Bitboard::NextRandomWord(ActiveWorld->RandomState) >> 32); }
+	int RandomInt(int max) { return (int)(Random() % (uint32_t)(max + 1)); } //0 to max
+	int RandomInt(size_t max) { return (int)(Random() % (uint32_t)(max + 1)); }
+
+	void SeedRandom(uint64_t seed) { ActiveWorld->RandomState = (seed * 0xBF58476D1CE4E5B9ull) ^ 0x9E3779B97F4A7C15ull; }
+
+	//a fresh cell of the material
+	Pixel NewPixel(uint8_t id) {
+		Pixel cell;
+		cell.ID = id;
+		cell.Temperature = Materials[id].SpawnTemperature;
+		return cell;
+	}
+
+	const Pixel& GetPixel(size_t pos) { return ActiveWorld->Pixels[pos]; }
+	const Pixel& GetPixel(size_t x, size_t y) { return ActiveWorld->Pixels[x + y * PIXELGRID_WIDTH]; }
 
 	bool InBounds(size_t x, size_t y) { return x < PIXELGRID_WIDTH&& y < PIXELGRID_HEIGHT; }
 	bool IsEmpty(size_t x, size_t y) { return InBounds(x, y) && GetPixel(x, y).ID == types::VACUUM; }
 
 	size_t GetIndex(size_t x, size_t y) { return x + y * PIXELGRID_WIDTH; }
 
+	//---CHUNKS---
+
+	bool IsChunkAwake(size_t cx, size_t cy) { return cx < CHUNKS_X && cy < CHUNKS_Y && ActiveWorld->ChunkAwake[cx + cy * CHUNKS_X]; }
+
+	void WakeChunk(size_t cx, size_t cy) {
+		if (cx < CHUNKS_X && cy < CHUNKS_Y) { ActiveWorld->ChunkAwakeNext[cx + cy * CHUNKS_X] = true; }
+	}
+
+	//wakes every chunk holding a cell within reach sideways, or one row up or down, of the changed cell
+	void WakeCell(size_t index, size_t reach = 1) {
+		size_t x = index % PIXELGRID_WIDTH;
+		size_t y = index / PIXELGRID_WIDTH;
+		size_t cy = y / CHUNK_SIZE;
+		for (size_t cx = (x - std::min(x, reach)) / CHUNK_SIZE; cx <= (x + reach) / CHUNK_SIZE; cx++) {
+			WakeChunk(cx, cy);
+			if (y % CHUNK_SIZE == 0) { WakeChunk(cx, cy - 1); }
+			if (y % CHUNK_SIZE == CHUNK_SIZE - 1) { WakeChunk(cx, cy + 1); }
+		}
+	}
+
+	void WakeAllChunks() { std::fill(ActiveWorld->ChunkAwakeNext, ActiveWorld->ChunkAwakeNext + CHUNKS_X * CHUNKS_Y, true); }
+
+	void BeginChunkTick() {
+		std::copy(ActiveWorld->ChunkAwakeNext, ActiveWorld->ChunkAwakeNext + CHUNKS_X * CHUNKS_Y, ActiveWorld->ChunkAwake);
+		std::fill(ActiveWorld->ChunkAwakeNext, ActiveWorld->ChunkAwakeNext + CHUNKS_X * CHUNKS_Y, false);
+	}
+
+	size_t AwakeChunkCount() { return std::count(ActiveWorld->ChunkAwake, ActiveWorld->ChunkAwake + CHUNKS_X * CHUNKS_Y, true); }
+
+	//anything that isn't a gas sinks through gases, otherwise the heavier cell wins
+	bool IsHeavier(const Pixel& a, const Pixel& b) {
+		if ((a.Type().Phase == types::GAS) != (b.Type().Phase == types::GAS)) { return b.Type().Phase == types::GAS; }
+		return a.GetMass() > b.GetMass();
+	}
+
 	bool IsMoveableTo(size_t xSrc, size_t ySrc, size_t x, size_t y, size_t type) {
 		if (type == (size_t)PixelMoveTypes::SWAP) {
-			return GetPixel(x, y).Phase != types::SOLID_STATIC &&
-				InBounds(x, y) &&
-				Pixels[GetIndex(xSrc, ySrc)].GetMass() > Pixels[GetIndex(x, y)].GetMass()
+			return InBounds(x, y) &&
+				GetPixel(x, y).Type().Phase != types::SOLID_STATIC &&
+				IsHeavier(GetPixel(xSrc, ySrc), GetPixel(x, y))
 				;
 		}
 		else if (type == (size_t)PixelMoveTypes::FLOOD || type == (size_t)PixelMoveTypes::TRUEFLOOD) {
 			return InBounds(x, y) &&
 				(GetPixel(x, y).ID == GetPixel(xSrc, ySrc).ID || GetPixel(x, y).ID == types::VACUUM) &&
-				GetPixel(x, y).Moles < 1 //1 is temporary, it represents moles# a pixel can hold
+				GetPixel(x, y).Moles < MOLES_PER_PIXEL
 				;
 		}
 		else if (type == (size_t)PixelMoveTypes::INJECT) {
@@ -132,49 +205,69 @@ namespace Pxl {
 		}
 	}
 
-	size_t GetClosestPixel(size_t x, size_t y) { return GetIndex((size_t)floor(x / PIXEL_SIZE), (size_t)floor(y / PIXEL_SIZE)); }
+	//IsMoveableTo with the move type fixed at compile time, the caller reads the source cell once
+	template <PixelMoveTypes Type> bool CanMoveTo(const Pixel& src, size_t x, size_t y);
 
-	void SetPixel(size_t x, size_t y, const Pixel& pixel) { Pixels[GetIndex(x, y)] = pixel; }
-	void SetPixel(size_t index, const Pixel& pixel) { Pixels[index] = pixel; }
+	template <> bool CanMoveTo<PixelMoveTypes::SWAP>(const Pixel& src, size_t x, size_t y) {
+		return InBounds(x, y) && GetPixel(x, y).Type().Phase != types::SOLID_STATIC && IsHeavier(src, GetPixel(x, y));
+	}
 
-	struct PixelMoveRequest {
-		size_t StartIndex;
-		size_t EndIndex;
-		size_t Type;
+	template <> bool CanMoveTo<PixelMoveTypes::FLOOD>(const Pixel& src, size_t x, size_t y) {
+		return InBounds(x, y) && (GetPixel(x, y).ID == src.ID || GetPixel(x, y).ID == types::VACUUM) && GetPixel(x, y).Moles < MOLES_PER_PIXEL;
+	}
+
+	template <> bool CanMoveTo<PixelMoveTypes::TRUEFLOOD>(const Pixel& src, size_t x, size_t y) { return CanMoveTo<PixelMoveTypes::FLOOD>(src, x, y); }
+
+	template <> bool CanMoveTo<PixelMoveTypes::INJECT>(const Pixel& src, size_t x, size_t y) {
+		return InBounds(x, y) && GetPixel(x, y).ID == src.ID;
+	}
+
+	//probe for the move helpers, one move type for the whole cell
+	template <PixelMoveTypes Type>
+	struct MoveProbe {
+		const Pixel& Src;
+		bool operator()(size_t x, size_t y) const { return CanMoveTo<Type>(Src, x, y); }
 	};
-	std::vector<PixelMoveRequest> PixelChangesBuffer; // (1)ending pixel <- (2)starting pixel
+
+	void SetPixel(size_t x, size_t y, const Pixel& pixel) { ActiveWorld->Pixels[GetIndex(x, y)] = pixel; }
+	void SetPixel(size_t index, const Pixel& pixel) { ActiveWorld->Pixels[index] = pixel; }
+
+	//a fall's speed only sticks once its move went through, dropped requests leave the cell as it was
+	void CommitVelocity(const PixelMoveRequest& move, size_t dst) {
+		if (move.Velocity >= 0) { ActiveWorld->Pixels[dst].Velocity.y = move.Velocity; }
+	}
 
 	void CommitPixels() {
 
-		std::sort(PixelChangesBuffer.begin(), PixelChangesBuffer.end(),
+		std::sort(ActiveWorld->PixelChangesBuffer.begin(), ActiveWorld->PixelChangesBuffer.end(),
 			[](auto& a, auto& b) { return a.EndIndex < b.EndIndex; }
 		);
 
 		//if multiple movements terminate at the same location, choose a random one to keep and delete the rest
 		size_t similarChangesIndex = 0;
 		size_t similarChangesCount = 0;
-		for (size_t i = 1; i < PixelChangesBuffer.size() + 1; i++) {
-			if (i != PixelChangesBuffer.size() &&
-				PixelChangesBuffer[i - 1].EndIndex == PixelChangesBuffer[i].EndIndex)
+		for (size_t i = 1; i < ActiveWorld->PixelChangesBuffer.size() + 1; i++) {
+			if (i != ActiveWorld->PixelChangesBuffer.size() &&
+				ActiveWorld->PixelChangesBuffer[i - 1].EndIndex == ActiveWorld->PixelChangesBuffer[i].EndIndex)
 			{
 				similarChangesCount++;
 			}
 			else {
 				if (similarChangesCount != 0) {
 
-					PixelMoveRequest chosenMove = PixelChangesBuffer[randInt(similarChangesCount) + similarChangesIndex];
+					PixelMoveRequest chosenMove = ActiveWorld->PixelChangesBuffer[RandomInt(similarChangesCount) + similarChangesIndex];
 
 					for (size_t j = 0; j < similarChangesCount; j++) {
-						PixelChangesBuffer.erase(PixelChangesBuffer.begin() + similarChangesIndex);
+						ActiveWorld->PixelChangesBuffer.erase(ActiveWorld->PixelChangesBuffer.begin() + similarChangesIndex);
 					}
-					PixelChangesBuffer[similarChangesIndex] = chosenMove;
+					ActiveWorld->PixelChangesBuffer[similarChangesIndex] = chosenMove;
 				}
 				similarChangesIndex = i;
 				similarChangesCount = 0;
 			}
 		}
 
-		std::sort(PixelChangesBuffer.begin(), PixelChangesBuffer.end(),
+		std::sort(ActiveWorld->PixelChangesBuffer.begin(), ActiveWorld->PixelChangesBuffer.end(),
 			[](auto& a, auto& b) { return a.Type > b.Type; }
 		);
 
@@ -182,70 +275,161 @@ namespace Pxl {
 
 		size_t iprev = 0;
 
-		PixelChangesBuffer.emplace_back(PixelMoveRequest{ (size_t)-1, (size_t)-1, (size_t)-1 }); // to catch final move
+		ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ (size_t)-1, (size_t)-1, (size_t)-1 }); // to catch final move
 
-		for (size_t i = 0; i < PixelChangesBuffer.size() - 1; i++) {
-			PixelMoveRequest currentChange = PixelChangesBuffer[i];
-			if (PixelChangesBuffer[i + 1].EndIndex != currentChange.EndIndex) {
-				size_t rand = iprev + (size_t)randInt(i - iprev);
+		for (size_t i = 0; i < ActiveWorld->PixelChangesBuffer.size() - 1; i++) {
+			PixelMoveRequest currentChange = ActiveWorld->PixelChangesBuffer[i];
+			if (ActiveWorld->PixelChangesBuffer[i + 1].EndIndex != currentChange.EndIndex) {
+				size_t rand = iprev + (size_t)RandomInt(i - iprev);
 
-				size_t dst = PixelChangesBuffer[rand].EndIndex;
-				size_t src = PixelChangesBuffer[rand].StartIndex;
+				size_t dst = ActiveWorld->PixelChangesBuffer[rand].EndIndex;
+				size_t src = ActiveWorld->PixelChangesBuffer[rand].StartIndex;
 
 				if (currentChange.Type == (size_t)PixelMoveTypes::SWAP &&
-					GetPixel(dst).Phase != types::SOLID_STATIC &&
-					Pixels[src].GetMass() > Pixels[dst].GetMass()
+					GetPixel(dst).Type().Phase != types::SOLID_STATIC &&
+					IsHeavier(GetPixel(src), GetPixel(dst))
 					) {
-					Pixel keptPixel = Pixels[dst];
-					Pixels[dst] = Pixels[src];
-					Pixels[src] = keptPixel;
+					Pixel keptPixel = ActiveWorld->Pixels[dst];
+					ActiveWorld->Pixels[dst] = ActiveWorld->Pixels[src];
+					ActiveWorld->Pixels[src] = keptPixel;
+					CommitVelocity(ActiveWorld->PixelChangesBuffer[rand], dst);
+					WakeCell(src);
+					WakeCell(dst);
 				}
 				else if ((currentChange.Type == (size_t)PixelMoveTypes::FLOOD || currentChange.Type == (size_t)PixelMoveTypes::TRUEFLOOD) &&
 					(GetPixel(dst).ID == GetPixel(src).ID || GetPixel(dst).ID == types::VACUUM) &&
-					GetPixel(dst).Moles < 1 //1 is temporary, it represents moles# a pixel can hold
+					GetPixel(dst).Moles < MOLES_PER_PIXEL
 					) {
+					//liquids look for drops up to a chunk away
+					WakeCell(src, CHUNK_SIZE);
+					WakeCell(dst, CHUNK_SIZE);
 					if (currentChange.Type == (size_t)PixelMoveTypes::FLOOD) {
-						float moleAddAmount = std::min(1 - GetPixel(dst).Moles, GetPixel(src).Moles); //1 is temporary, it represents moles# a pixel can hold (again...)
+						uint16_t moleAddAmount = std::min((uint16_t)(MOLES_PER_PIXEL - GetPixel(dst).Moles), GetPixel(src).Moles);
 						if (GetPixel(dst).ID == types::VACUUM) {
-							Pixels[dst] = Pixels[src];
-							Pixels[src] = PixelTypes[types::VACUUM];
+							ActiveWorld->Pixels[dst] = ActiveWorld->Pixels[src];
+							ActiveWorld->Pixels[src] = Pixel();
+							CommitVelocity(ActiveWorld->PixelChangesBuffer[rand], dst);
 						}
 						else {
-							Pixels[dst].Moles += moleAddAmount;
-							Pixels[src].Moles -= moleAddAmount;
-							if (Pixels[src].Moles == 0) {
-								Pixels[src] = PixelTypes[types::VACUUM];
+							ActiveWorld->Pixels[dst].Moles += moleAddAmount;
+							ActiveWorld->Pixels[src].Moles -= moleAddAmount;
+							if (ActiveWorld->Pixels[src].Moles == 0) {
+								ActiveWorld->Pixels[src] = Pixel();
 							}
 						}
 					}
-					else if (Pixels[src].Moles > 0.1) { //TRUEFLOOD
-						float moleSetAmount = 0.5 * (GetPixel(dst).Moles + GetPixel(src).Moles); //finding average
+					else if (ActiveWorld->Pixels[src].Moles > MOLES_PER_PIXEL / 10 && GetPixel(dst).Moles != GetPixel(src).Moles) { //TRUEFLOOD
+						//the odd unit stays with the source so nothing gets lost to rounding
+						int total = GetPixel(dst).Moles + GetPixel(src).Moles;
 						if (GetPixel(dst).ID == types::VACUUM) {
-							Pixels[dst] = Pixels[src];
-
-							Pixels[src].Moles = moleSetAmount;
-							Pixels[dst].Moles = moleSetAmount;
-						}
-						else {
-							Pixels[dst].Moles = moleSetAmount;
-							Pixels[src].Moles = moleSetAmount;
+							ActiveWorld->Pixels[dst] = ActiveWorld->Pixels[src];
 						}
+						ActiveWorld->Pixels[dst].Moles = (uint16_t)(total / 2);
+						ActiveWorld->Pixels[src].Moles = (uint16_t)(total - total / 2);
 					}
 				}
 				else if (currentChange.Type == (size_t)PixelMoveTypes::INJECT) {
-					Pixels[dst] = Pixels[src];
-					Pixels[dst].Moles += Pixels[src].Moles;
-					SetPixel(src, PixelTypes[types::VACUUM]);
+					//packs the source into the destination as far as the counter goes, whatever doesn't fit stays behind
+					uint16_t moleAddAmount = std::min((uint16_t)(UINT16_MAX - GetPixel(dst).Moles), GetPixel(src).Moles);
+					ActiveWorld->Pixels[dst].Moles += moleAddAmount;
+					ActiveWorld->Pixels[src].Moles -= moleAddAmount;
+					if (ActiveWorld->Pixels[src].Moles == 0) {
+						SetPixel(src, Pixel());
+					}
+					WakeCell(src);
+					WakeCell(dst);
 				}
 
 				iprev = i + 1;
 			}
 		}
 
-		PixelChangesBuffer.clear();
+		ActiveWorld->PixelChangesBuffer.clear();
+	}
+
+	//in cells per tick
+	const double GRAVITY = 0.2;
+	const double MAX_VELOCITY = 8.0;
+
+	//---FREE PARTICLES---
+	//cells falling at least this fast leave the grid until they land
+	const double LIFT_VELOCITY = 4.0;
+	//airborne particles slower than this go back into the grid
+	const float DEPOSIT_VELOCITY = 1.0f;
+	const float AIR_DRAG = 0.98f;
+
+	//takes the cell out of the grid and lets it fly, used for anything that throws material around
+	void EjectPixel(size_t index, double vx, double vy) {
+		Pixel payload = ActiveWorld->Pixels[index];
+		payload.Velocity = Vector2{ 0,0 };
+		ActiveWorld->FreeParticles.Add((float)(index % PIXELGRID_WIDTH) + 0.5f, (float)(index / PIXELGRID_WIDTH) + 0.5f, (float)vx, (float)vy, payload);
+		SetPixel(index, Pixel());
+		WakeCell(index);
+	}
+
+	void LiftPendingPixels() {
+		for (size_t i = 0; i < ActiveWorld->PendingLifts.size(); i++) {
+			const Pixel& cell = GetPixel(ActiveWorld->PendingLifts[i]);
+			EjectPixel(ActiveWorld->PendingLifts[i], cell.Velocity.x, cell.Velocity.y);
+		}
+		ActiveWorld->PendingLifts.clear();
+	}
+
+	//puts a particle back at x, y or the first empty cell above it, false if there is no room yet
+	bool DepositParticle(size_t particle, size_t x, size_t y, bool landed) {
+		for (size_t i = 0; i <= (size_t)MAX_VELOCITY && y - i < PIXELGRID_HEIGHT; i++) {
+			if (IsEmpty(x, y - i)) {
+				Pixel& cell = ActiveWorld->Pixels[GetIndex(x, y - i)];
+				cell = ActiveWorld->FreeParticles.Payloads[particle];
+				cell.Velocity = landed ? Vector2{ 0,0 } : Vector2{ 0, (double)ActiveWorld->FreeParticles.VelocityY[particle] };
+				WakeCell(GetIndex(x, y - i));
+				return true;
+			}
+		}
+		return false;
 	}
 
-	Pixel selectedPixel = PixelTypes[types::VACUUM];
+	void StepParticles() {
+		ActiveWorld->FreeParticles.Integrate((float)GRAVITY, (float)MAX_VELOCITY, AIR_DRAG);
+
+		for (size_t i = 0; i < ActiveWorld->FreeParticles.Size();) {
+			float vx = ActiveWorld->FreeParticles.VelocityX[i];
+			float vy = ActiveWorld->FreeParticles.VelocityY[i];
+			float startX = ActiveWorld->FreeParticles.X[i] - vx;
+			float startY = ActiveWorld->FreeParticles.Y[i] - vy;
+
+			//walk the cells crossed this tick, the last empty one is where it lands
+			size_t freeX = (size_t)floor(startX);
+			size_t freeY = (size_t)floor(startY);
+			bool landed = false;
+			int steps = (int)ceil(std::max(std::abs(vx), std::abs(vy)));
+			for (int step = 1; step <= steps; step++) {
+				size_t cellX = (size_t)floor(startX + vx * step / steps);
+				size_t cellY = (size_t)floor(startY + vy * step / steps);
+				if (!IsEmpty(cellX, cellY)) {
+					landed = true;
+					break;
+				}
+				freeX = cellX;
+				freeY = cellY;
+			}
+
+			bool slowedDown = sqrt(vx * vx + vy * vy) < DEPOSIT_VELOCITY;
+			if ((landed || slowedDown) && DepositParticle(i, freeX, freeY, landed)) {
+				ActiveWorld->FreeParticles.Remove(i);
+				continue;
+			}
+
+			if (landed) {
+				//no room to land yet, wait in front of the obstacle
+				ActiveWorld->FreeParticles.X[i] = (float)freeX + 0.5f;
+				ActiveWorld->FreeParticles.Y[i] = (float)freeY + 0.5f;
+				ActiveWorld->FreeParticles.VelocityX[i] = 0;
+				ActiveWorld->FreeParticles.VelocityY[i] = 0;
+			}
+			i++;
+		}
+	}
 
 	//slows down pixels
 
@@ -258,26 +442,28 @@ namespace Pxl {
 	{
 		bool canMove = IsMoveableTo(x,y, endX, endY, moveType);
 		if (canMove) {
-			PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX, endY), moveType });
+			ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX, endY), moveType });
 		}
 
 		return canMove;
 	}
 
+	//canMove(x, y) says whether the cell can go there
+	template <typename Probe>
 	bool MovePixelRandom(
-		size_t x, size_t y, 
+		size_t x, size_t y,
 		size_t endX1, size_t endY1,
 		size_t endX2, size_t endY2,
-		const Pixel& cell,
-		size_t moveType
+		size_t moveType,
+		Probe canMove
 		)
 	{
-		bool choice1 = IsMoveableTo(x,y, endX1, endY1, moveType);
-		bool choice2 = IsMoveableTo(x,y, endX2, endY2, moveType);
+		bool choice1 = canMove(endX1, endY1);
+		bool choice2 = canMove(endX2, endY2);
 
 		if (choice1 && choice2) {
-			float Pixel1Mass = Pixels[GetIndex(endX1, endY1)].GetMass();
-			float Pixel2Mass = Pixels[GetIndex(endX2, endY2)].GetMass();
+			float Pixel1Mass = ActiveWorld->Pixels[GetIndex(endX1, endY1)].GetMass();
+			float Pixel2Mass = ActiveWorld->Pixels[GetIndex(endX2, endY2)].GetMass();
 
 			if (Pixel1Mass > Pixel2Mass) {
 				choice1 = false;
@@ -288,32 +474,294 @@ namespace Pxl {
 				choice2 = false;
 			}
 			else {
-				choice1 = randInt(1) - 1 == 0;
+				choice1 = RandomInt(1) - 1 == 0;
 				choice2 = !choice1;
 			}
 		}
 
-		if (choice1) PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX1, endY1), moveType });
-		else if (choice2) PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX2, endY2), moveType });
+		if (choice1) ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX1, endY1), moveType });
+		else if (choice2) ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX2, endY2), moveType });
 
 		return choice1 || choice2;
 	}
 
+	bool MovePixelRandom(
+		size_t x, size_t y, 
+		size_t endX1, size_t endY1,
+		size_t endX2, size_t endY2,
+		const Pixel& cell,
+		size_t moveType
+		)
+	{
+		return MovePixelRandom(x, y, endX1, endY1, endX2, endY2, moveType,
+			[x, y, moveType](size_t endX, size_t endY) { return IsMoveableTo(x, y, endX, endY, moveType); });
+	}
+
+	//---BITBOARD POWDER KERNEL---
+	//the bitboard engine uses AVX2 when the cpu has it
+	bool BitboardUseAVX2 = false;
+
+	namespace Bitboard {
+		const size_t ROW_WORDS = RowWords(PIXELGRID_WIDTH);
+		const size_t ROW_STRIDE = RowStride(PIXELGRID_WIDTH);
+
+		//scratch rebuilt every tick, each thread has its own so worlds can step side by side
+		//the extra bottom row stays zero so powders see the floor as a wall
+		thread_local std::vector<uint64_t> PowderPlane(ROW_STRIDE * (PIXELGRID_HEIGHT + 1));
+		thread_local std::vector<uint64_t> EmptyPlane(ROW_STRIDE * (PIXELGRID_HEIGHT + 1));
+		thread_local std::vector<uint64_t> FluidPlane(ROW_STRIDE * (PIXELGRID_HEIGHT + 1)); //anything a powder may sink into, needs a mass check
+		thread_local std::vector<uint64_t> RandomPlaneA(ROW_STRIDE * PIXELGRID_HEIGHT);
+		thread_local std::vector<uint64_t> RandomPlaneB(ROW_STRIDE * PIXELGRID_HEIGHT);
+		thread_local std::vector<uint64_t> FallbackPlane(ROW_STRIDE * PIXELGRID_HEIGHT);
+		thread_local std::vector<uint64_t> FastPlane(ROW_STRIDE * PIXELGRID_HEIGHT); //falls more than a cell, needs MovePixelFall
+
+		thread_local std::vector<uint64_t> LeftRow(ROW_STRIDE);
+		thread_local std::vector<uint64_t> RightRow(ROW_STRIDE);
+		thread_local std::vector<uint64_t> DownRow(ROW_STRIDE);
+		thread_local std::vector<uint64_t> DownLeftRow(ROW_STRIDE);
+		thread_local std::vector<uint64_t> DownRightRow(ROW_STRIDE);
+
+		uint64_t* Row(std::vector<uint64_t>& plane, size_t y) { return plane.data() + y * ROW_STRIDE + GUARD_WORDS; }
+
+		bool IsFallback(size_t x, size_t y) { return ((Row(FallbackPlane, y)[x >> 6] | Row(FastPlane, y)[x >> 6]) >> (x & 63)) & 1; }
+
+		/* Powders resting on other powders are treated as blocked unless the one below could be lighter.
+		* Those go into the fluid plane too, so powders above them take the scalar path and its mass check */
+		bool IsSinkablePowder(const Pixel& cell, float heaviestDensity) {
+			return cell.Moles != MOLES_PER_PIXEL || cell.Type().Density < heaviestDensity;
+		}
+
+		//powders of awake chunks can land in the chunks beside and below them
+		bool NeedsPlanes(size_t cx, size_t cy) {
+			for (size_t i = cx - 1; i != cx + 2; i++) {
+				if (IsChunkAwake(i, cy) || IsChunkAwake(i, cy - 1)) { return true; }
+			}
+			return false;
+		}
+
+		void BuildPlanes() {
+			std::fill(PowderPlane.begin(), PowderPlane.end(), 0);
+			std::fill(EmptyPlane.begin(), EmptyPlane.end(), 0);
+			std::fill(FluidPlane.begin(), FluidPlane.end(), 0);
+			std::fill(FastPlane.begin(), FastPlane.end(), 0);
+
+			//with a single powder density full cells never sink into each other
+			float heaviestDensity = 0;
+			for (size_t id = 0; id < MaterialCount; id++) {
+				if (Materials[id].Phase == types::SOLID_POWDER) { heaviestDensity = std::max(heaviestDensity, Materials[id].Density); }
+			}
+
+			for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+				if (!NeedsPlanes(cx, cy)) { continue; }
+				bool awake = IsChunkAwake(cx, cy);
+
+				for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++) {
+					uint64_t* powder = Row(PowderPlane, y);
+					uint64_t* empty = Row(EmptyPlane, y);
+					uint64_t* fluid = Row(FluidPlane, y);
+					uint64_t* fast = Row(FastPlane, y);
+					for (size_t x = cx * CHUNK_SIZE; x < std::min((cx + 1) * CHUNK_SIZE, PIXELGRID_WIDTH); x++) {
+						Pixel& cell = ActiveWorld->Pixels[GetIndex(x, y)];
+						uint64_t bit = 1ull << (x & 63);
+						if (cell.ID == types::VACUUM) { empty[x >> 6] |= bit; }
+						else if (cell.Type().Phase > types::SOLID_POWDER) { fluid[x >> 6] |= bit; }
+						else if (cell.Type().Phase == types::SOLID_POWDER && IsSinkablePowder(cell, heaviestDensity)) { fluid[x >> 6] |= bit; }
+
+						//sleeping powders stay out of the kernel
+						if (awake && cell.Type().Phase == types::SOLID_POWDER) {
+							//landed since the last tick
+							if (cell.Velocity.y != 0 && !IsEmpty(x, y + 1)) { cell.Velocity = Vector2{ 0,0 }; }
+
+							if (cell.Velocity.y + GRAVITY >= 2) { fast[x >> 6] |= bit; }
+							else { powder[x >> 6] |= bit; }
+						}
+					}
+				}
+			}
+
+			//seeded from the world so a run stays reproducible
+			uint64_t state = Bitboard::NextRandomWord(ActiveWorld->RandomState) ^ 0x9E3779B97F4A7C15ull;
+			for (size_t y = 0; y < PIXELGRID_HEIGHT; y++) {
+				uint64_t* randomA = Row(RandomPlaneA, y);
+				uint64_t* randomB = Row(RandomPlaneB, y);
+				for (size_t i = 0; i < ROW_WORDS; i++) {
+					randomA[i] = NextRandomWord(state);
+					randomB[i] = NextRandomWord(state);
+				}
+			}
+		}
+
+		//turns target bits on row y + 1 into move requests, srcOffset is the source column relative to the target
+		void EmitMoves(const uint64_t* targets, size_t y, int srcOffset) {
+			for (size_t i = 0; i < ROW_WORDS; i++) {
+				uint64_t word = targets[i];
+				while (word) {
+					size_t x = i * 64 + CountTrailingZeros(word);
+					word &= word - 1;
+
+					//straight falls pick up speed like MovePixelFall does, diagonal ones lose it
+					const Pixel& cell = GetPixel(x + srcOffset, y);
+					double velocity = srcOffset == 0 ? std::min(cell.Velocity.y + GRAVITY, MAX_VELOCITY) : 0;
+
+					ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x + srcOffset, y), GetIndex(x, y + 1), (size_t)PixelMoveTypes::SWAP, velocity });
+				}
+			}
+		}
+
+		//queues every powder move that doesn't need a mass check, the rest is flagged for UpdatePixelsMove
+		void UpdatePowders() {
+			BuildPlanes();
+
+			PowderMoves moves{ Row(LeftRow, 0), Row(RightRow, 0), Row(DownRow, 0), Row(DownLeftRow, 0), Row(DownRightRow, 0), nullptr };
+			for (size_t y = 0; y < PIXELGRID_HEIGHT; y++) {
+				PowderRow row{ Row(PowderPlane, y), Row(EmptyPlane, y + 1), Row(FluidPlane, y + 1), Row(RandomPlaneA, y), Row(RandomPlaneB, y) };
+				moves.Fallback = Row(FallbackPlane, y);
+
+				ComputePowderMoves(row, moves, ROW_WORDS, BitboardUseAVX2);
+
+				EmitMoves(moves.Down, y, 0);
+				EmitMoves(moves.DownLeft, y, 1);
+				EmitMoves(moves.DownRight, y, -1);
+			}
+		}
+	}
+
+	//DDA walk from x, y along vx, vy, stops in front of the first cell it can't move into
+	template <typename Probe>
+	bool TraceMove(size_t x, size_t y, double vx, double vy, Probe canMove, size_t& endX, size_t& endY) {
+		int steps = (int)std::max(std::abs(vx), std::abs(vy));
+		endX = x;
+		endY = y;
+		for (int i = 1; i <= steps; i++) {
+			size_t stepX = (size_t)((long long)x + llround(vx * i / steps));
+			size_t stepY = (size_t)((long long)y + llround(vy * i / steps));
+			if (!InBounds(stepX, stepY) || !canMove(stepX, stepY)) { break; }
+
+			endX = stepX;
+			endY = stepY;
+
+			//only vacuum can be passed through, anything else ends the move where it is
+			if (GetPixel(stepX, stepY).ID != types::VACUUM) { break; }
+		}
+		return endX != x || endY != y;
+	}
+
+	//falls along the accumulated velocity, one request however many cells it covers
+	template <typename Probe>
+	bool MovePixelFall(size_t x, size_t y, size_t moveType, Probe canMove) {
+		Pixel& cell = ActiveWorld->Pixels[GetIndex(x, y)];
+		double speed = std::min(cell.Velocity.y + GRAVITY, MAX_VELOCITY);
+		double distance = std::max(1.0, floor(speed));
+
+		size_t endX, endY;
+		if (!TraceMove(x, y, 0, distance, canMove, endX, endY)) {
+			cell.Velocity = Vector2{ 0,0 };
+			return false;
+		}
+
+		//fast and still in free fall, hand it over to the particle system
+		bool landed = endY - y < (size_t)distance;
+		if (speed >= LIFT_VELOCITY && !landed) {
+			cell.Velocity.y = speed;
+			ActiveWorld->PendingLifts.push_back(GetIndex(x, y));
+			return true;
+		}
+
+		//landing on something short of the full distance takes the speed away
+		ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX, endY), moveType, landed ? 0.0 : speed });
+		return true;
+	}
+
+	bool MovePixelFall(size_t x, size_t y, size_t moveType) {
+		return MovePixelFall(x, y, moveType, [x, y, moveType](size_t endX, size_t endY) { return IsMoveableTo(x, y, endX, endY, moveType); });
+	}
+
+	//how far a liquid looks for somewhere lower to flow to, liquid moves wake chunks this far away
+	const int DISPERSION_LOOKAHEAD = (int)CHUNK_SIZE;
+
+	/* Flows sideways through vacuum, up to the material's dispersion rate in one request.
+	* A liquid only flows when it sees a drop ahead or has liquid pressing on it from above,
+	* so a settled layer stops moving instead of shuffling back and forth */
+	bool MovePixelDisperse(size_t x, size_t y, const Pixel& cell) {
+		bool pressed = y > 0 && GetPixel(x, y - 1).ID == cell.ID;
+		int firstDir = RandomInt(1) == 0 ? -1 : 1;
+
+		for (int dir = firstDir, attempt = 0; attempt < 2; dir = -dir, attempt++) {
+			size_t endX = x;
+			bool foundDrop = false;
+			for (int i = 1; i <= std::max(cell.Type().DispersionRate, DISPERSION_LOOKAHEAD); i++) {
+				size_t stepX = x + dir * i;
+				if (!IsEmpty(stepX, y)) { break; }
+
+				if (i <= cell.Type().DispersionRate) { endX = stepX; }
+				if (IsEmpty(stepX, y + 1)) {
+					foundDrop = true;
+					break;
+				}
+			}
+
+			if (endX != x && (foundDrop || pressed)) {
+				ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX, y), (size_t)PixelMoveTypes::FLOOD });
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//---GASES---
+	//gases lighter than air rise, heavier ones sink
+	const float AIR_ATOM_MASS = 29.0f;
+	//a gas cell needs at least twice this many moles to split, so a spread out cloud comes to rest
+	const uint16_t GAS_MIN_MOLES = MOLES_PER_PIXEL / 8;
+
+	bool IsGas(const Pixel& cell) { return cell.Type().Phase == types::GAS && cell.ID != types::VACUUM; }
+
+	/* Buoyancy moves the whole cell up (or down) into vacuum, more often the further its atom
+	* mass is from air. Otherwise a cell dense enough splits its moles with a random empty
+	* neighbour, that random walk is how a cloud spreads */
+	bool MoveGas(size_t x, size_t y, const Pixel& cell) {
+		float lift = (AIR_ATOM_MASS - cell.Type().AtomMass) / AIR_ATOM_MASS;
+		size_t liftY = lift > 0 ? y - 1 : y + 1;
+		if (IsEmpty(x, liftY) && RandomInt(99) < (int)(std::abs(lift) * 100)) {
+			ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(x, liftY), (size_t)PixelMoveTypes::FLOOD });
+			return true;
+		}
+
+		if (cell.Moles >= 2 * GAS_MIN_MOLES) {
+			const int offsets[4][2] = { { -1,0 }, { 1,0 }, { 0,-1 }, { 0,1 } };
+			int first = RandomInt(3);
+			for (int i = 0; i < 4; i++) {
+				size_t endX = x + offsets[(first + i) % 4][0];
+				size_t endY = y + offsets[(first + i) % 4][1];
+				if (IsEmpty(endX, endY)) {
+					ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(endX, endY), (size_t)PixelMoveTypes::TRUEFLOOD });
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	//generic path, checks the phase for every rule and the move type for every probe
+	//kept as the reference for the specialised kernels below
 	void UpdatePixelsMove(size_t x, size_t y) {
 		const Pixel& currentPixel = GetPixel(x, y);
-		if (currentPixel.ID != types::VACUUM && currentPixel.Phase != types::SOLID_STATIC) {
+		const Material& material = currentPixel.Type();
+		if (currentPixel.ID != types::VACUUM && material.Phase != types::SOLID_STATIC) {
 
-			if (currentPixel.Phase > types::SOLID_POWDER) {
+			if (material.Phase == types::GAS) {
+				//GASES
+				MoveGas(x, y, currentPixel);
+			}
+
+			else if (material.Phase == types::LIQUID) {
 				//FLUIDS
 				//move down
-				if (MovePixelDirect(
-					x, y,
-
-					x, y + 1,
-
-					currentPixel,
-					(size_t)PixelMoveTypes::FLOOD
-				)){}
+				if (MovePixelFall(x, y, (size_t)PixelMoveTypes::FLOOD)){}
+				//sink through gas, the gas bubbles up
+				else if (InBounds(x, y + 1) && IsGas(GetPixel(x, y + 1)) &&
+					MovePixelDirect(x, y, x, y + 1, currentPixel, (size_t)PixelMoveTypes::SWAP)){}
 				//move down-sideways
 				else if (MovePixelRandom(
 					x, y,
@@ -324,8 +772,10 @@ namespace Pxl {
 					currentPixel,
 					(size_t)PixelMoveTypes::FLOOD
 				)){}
-				//move sideways
-				else if (MovePixelRandom(
+				//flow sideways
+				else if (MovePixelDisperse(x, y, currentPixel)){}
+				//liquids that can't flow level out by splitting with their neighbours, EqualizeLiquids evens out the rest
+				else if (material.DispersionRate == 0 && MovePixelRandom(
 					x, y,
 
 					x-1, y,
@@ -337,15 +787,11 @@ namespace Pxl {
 			}
 
 			//POWDERS
-			//move down
-			else if (MovePixelDirect(
-				x, y,
-
-				x, y + 1,
+			//already queued by the bitboard kernel
+			else if (ActiveWorld->UseBitboardKernel && !Bitboard::IsFallback(x, y)) {}
 
-				currentPixel,
-				(size_t)PixelMoveTypes::SWAP
-			)){}
+			//move down
+			else if (MovePixelFall(x, y, (size_t)PixelMoveTypes::SWAP)){}
 
 			//move down and sideways (for powders only)
 			else if (MovePixelRandom(
@@ -360,82 +806,573 @@ namespace Pxl {
 		}
 	}
 
-	void UpdatePixels(bool isPaused, SDL_Point mPosition, SDL_Point mPositionOld, Uint32 mButton, bool mouseClick, int pxlState) {
-		//placing pixels
-		if (mButton)
-		{
-			if (pxlState == 2) {
-				if (mButton) {
-					float dir = (float)atan2(mPositionOld.y - mPosition.y, mPositionOld.x - mPosition.x);
-					Vector2 pxlTurtle = Vector2{ (double)mPosition.x,(double)mPosition.y };
-					for (int i = 0; findGLen(mPosition, SDL_Point{ (int)pxlTurtle.x, (int)pxlTurtle.y }) <= findGLen(mPosition, mPositionOld); i++) {
-						if (!(pxlTurtle.y >= SCREEN_HEIGHT - 1 || pxlTurtle.x >= SCREEN_WIDTH - 1)) {
-
-							const size_t targetIndex = GetClosestPixel((size_t)pxlTurtle.x, (size_t)pxlTurtle.y);
-							switch (mButton) {
-							case SDL_BUTTON_LEFT:
-								SetPixel(targetIndex, selectedPixel);
-								Pixels[targetIndex].Moles = 1;
-								break;
-							case SDL_BUTTON_X1:
-								SetPixel(targetIndex, PixelTypes[types::VACUUM]);
-								Pixels[targetIndex].Moles = 0;
-								break;
-							default:
-								break;
+	//---SPECIALISED KERNELS---
+	//same rules as UpdatePixelsMove with the phase and move types known at compile time, the phase is looked up once per cell
+
+	template <int Phase> void MoveCell(size_t x, size_t y, const Pixel& cell) {}
+
+	template <> void MoveCell<types::GAS>(size_t x, size_t y, const Pixel& cell) { MoveGas(x, y, cell); }
+
+	template <> void MoveCell<types::LIQUID>(size_t x, size_t y, const Pixel& cell) {
+		MoveProbe<PixelMoveTypes::FLOOD> flood{ cell };
+		if (MovePixelFall(x, y, (size_t)PixelMoveTypes::FLOOD, flood)) { return; }
+
+		//sink through gas, the gas bubbles up
+		if (InBounds(x, y + 1) && IsGas(GetPixel(x, y + 1)) && CanMoveTo<PixelMoveTypes::SWAP>(cell, x, y + 1)) {
+			ActiveWorld->PixelChangesBuffer.emplace_back(PixelMoveRequest{ GetIndex(x, y), GetIndex(x, y + 1), (size_t)PixelMoveTypes::SWAP });
+			return;
+		}
+
+		if (MovePixelRandom(x, y, x - 1, y + 1, x + 1, y + 1, (size_t)PixelMoveTypes::FLOOD, flood)) { return; }
+		if (MovePixelDisperse(x, y, cell)) { return; }
+		if (cell.Type().DispersionRate == 0) {
+			MovePixelRandom(x, y, x - 1, y, x + 1, y, (size_t)PixelMoveTypes::TRUEFLOOD, MoveProbe<PixelMoveTypes::TRUEFLOOD>{ cell });
+		}
+	}
+
+	template <> void MoveCell<types::SOLID_POWDER>(size_t x, size_t y, const Pixel& cell) {
+		//already queued by the bitboard kernel
+		if (ActiveWorld->UseBitboardKernel && !Bitboard::IsFallback(x, y)) { return; }
+
+		MoveProbe<PixelMoveTypes::SWAP> swap{ cell };
+		if (MovePixelFall(x, y, (size_t)PixelMoveTypes::SWAP, swap)) { return; }
+		MovePixelRandom(x, y, x - 1, y + 1, x + 1, y + 1, (size_t)PixelMoveTypes::SWAP, swap);
+	}
+
+	void UpdatePixelsMoveSpecialised(size_t x, size_t y) {
+		const Pixel& cell = GetPixel(x, y);
+		if (cell.ID == types::VACUUM) { return; }
+		switch (cell.Type().Phase) {
+		case types::GAS: MoveCell<types::GAS>(x, y, cell); break;
+		case types::LIQUID: MoveCell<types::LIQUID>(x, y, cell); break;
+		case types::SOLID_POWDER: MoveCell<types::SOLID_POWDER>(x, y, cell); break;
+		default: break;
+		}
+	}
+
+	//top of a liquid that can't fall any further, the cell below is neither empty nor the same liquid with room left
+	bool IsSettledSurface(size_t x, size_t y) {
+		return (y == 0 || GetPixel(x, y - 1).ID != GetPixel(x, y).ID) &&
+			(y + 1 >= PIXELGRID_HEIGHT ||
+			(GetPixel(x, y + 1).ID != types::VACUUM && (GetPixel(x, y + 1).ID != GetPixel(x, y).ID || GetPixel(x, y + 1).Moles >= MOLES_PER_PIXEL)))
+			;
+	}
+
+	/* Spreads the moles of side by side surface cells of one liquid evenly, the total stays the same,
+	* the units that don't divide evenly go one each to the leftmost cells.
+	* Cells under the surface are left alone, they get topped up by whatever falls into them */
+	void EqualizeLiquids() {
+		for (size_t cy = 0; cy < CHUNKS_Y; cy++) {
+			bool rowAwake = false;
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) { rowAwake |= IsChunkAwake(cx, cy); }
+			if (!rowAwake) { continue; }
+
+			for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++) {
+				for (size_t x = 0; x < PIXELGRID_WIDTH;) {
+					const Pixel& first = GetPixel(x, y);
+					if (first.Type().Phase != types::LIQUID || first.ID == types::VACUUM || !IsSettledSurface(x, y)) {
+						x++;
+						continue;
+					}
+
+					size_t end = x;
+					size_t total = 0;
+					bool partial = false;
+					while (end < PIXELGRID_WIDTH && GetPixel(end, y).ID == first.ID && IsSettledSurface(end, y)) {
+						total += GetPixel(end, y).Moles;
+						partial |= GetPixel(end, y).Moles < MOLES_PER_PIXEL;
+						end++;
+					}
+
+					if (partial && end - x > 1) {
+						size_t level = total / (end - x);
+						size_t remainder = total % (end - x);
+						for (size_t i = x; i < end; i++) {
+							uint16_t moles = (uint16_t)(level + (i - x < remainder ? 1 : 0));
+							if (ActiveWorld->Pixels[GetIndex(i, y)].Moles != moles) {
+								ActiveWorld->Pixels[GetIndex(i, y)].Moles = moles;
+								//a run thinner than one unit per cell leaves empty cells behind
+								if (moles == 0) { SetPixel(i, y, Pixel()); }
+								WakeCell(GetIndex(i, y));
 							}
 						}
-						pxlTurtle.x += PIXEL_SIZE * cos(dir);
-						pxlTurtle.y += PIXEL_SIZE * sin(dir);
 					}
+					x = end;
 				}
 			}
 		}
+	}
+
+	namespace Gas {
+		//gas id per cell, -1 for anything that isn't a gas, padded like the heat planes so the world edge is closed
+		const size_t PLANE_WIDTH = PIXELGRID_WIDTH + 2;
+		thread_local std::vector<int32_t> IdPlane(PLANE_WIDTH * (PIXELGRID_HEIGHT + 2), -1);
+		thread_local std::vector<int32_t> MolesPlane(PLANE_WIDTH * (PIXELGRID_HEIGHT + 2));
+		thread_local std::vector<int32_t> NextPlane(PLANE_WIDTH * (PIXELGRID_HEIGHT + 2));
 
-		//pixel updating loop
-		if (!isPaused) {
-			//gravity updates
-			for (int x = 0; x < PIXELGRID_WIDTH; x++)
-			for (int y = 0; y < PIXELGRID_HEIGHT; y++) {
-				UpdatePixelsMove(x, y);
+		size_t PlaneIndex(size_t x, size_t y) { return x + 1 + (y + 1) * PLANE_WIDTH; }
+
+		//a neighbouring cell of the same gas gets an eighth of the difference, rounded towards zero on both sides so no moles get lost
+		inline int32_t Flow(int32_t id, int32_t moles, int32_t otherId, int32_t otherMoles) {
+			return (id == otherId && id >= 0) ? (moles - otherMoles) / 8 : 0;
+		}
+
+		//branch-free over plain int arrays, vectorises like the heat stencil
+		void SpreadRow(const int32_t* id, const int32_t* m, int32_t* next, size_t count) {
+			const int32_t* idUp = id - PLANE_WIDTH;
+			const int32_t* idDown = id + PLANE_WIDTH;
+			const int32_t* up = m - PLANE_WIDTH;
+			const int32_t* down = m + PLANE_WIDTH;
+			for (size_t i = 0; i < count; i++) {
+				next[i] = m[i] -
+					Flow(id[i], m[i], id[i - 1], m[i - 1]) -
+					Flow(id[i], m[i], id[i + 1], m[i + 1]) -
+					Flow(id[i], m[i], idUp[i], up[i]) -
+					Flow(id[i], m[i], idDown[i], down[i]);
 			}
 		}
 
-		CommitPixels();
+		/* Evens out the pressure inside each cloud of awake chunks, MoveGas handles the edges.
+		* Cells outside awake chunks stay -1 and close the boundary, a chunk where anything
+		* still flowed is kept awake along with its neighbours, an even cloud goes to sleep */
+		void Spread() {
+			for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+				if (!IsChunkAwake(cx, cy)) { continue; }
+				for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++)
+				for (size_t x = cx * CHUNK_SIZE; x < std::min((cx + 1) * CHUNK_SIZE, PIXELGRID_WIDTH); x++) {
+					const Pixel& cell = GetPixel(x, y);
+					IdPlane[PlaneIndex(x, y)] = IsGas(cell) ? cell.ID : -1;
+					MolesPlane[PlaneIndex(x, y)] = cell.Moles;
+				}
+			}
+
+			for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+				if (!IsChunkAwake(cx, cy)) { continue; }
+				size_t startX = cx * CHUNK_SIZE;
+				size_t endX = std::min(startX + CHUNK_SIZE, PIXELGRID_WIDTH);
+				for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++) {
+					size_t start = PlaneIndex(startX, y);
+					SpreadRow(&IdPlane[start], &MolesPlane[start], &NextPlane[start], endX - startX);
+				}
+			}
+
+			for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+				if (!IsChunkAwake(cx, cy)) { continue; }
+				bool flowed = false;
+				for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++)
+				for (size_t x = cx * CHUNK_SIZE; x < std::min((cx + 1) * CHUNK_SIZE, PIXELGRID_WIDTH); x++) {
+					size_t i = PlaneIndex(x, y);
+					if (IdPlane[i] >= 0 && NextPlane[i] != MolesPlane[i]) {
+						ActiveWorld->Pixels[GetIndex(x, y)].Moles = (uint16_t)NextPlane[i];
+						flowed = true;
+					}
+					IdPlane[i] = -1;
+				}
+				if (flowed) {
+					for (size_t i = cx - 1; i != cx + 2; i++) {
+						for (size_t j = cy - 1; j != cy + 2; j++) { WakeChunk(i, j); }
+					}
+				}
+			}
+		}
 	}
 
-	void LoadPixels(SDL_Point closestPixel, int pxlState) {
-		const int screenWidthPxl = SCREEN_WIDTH / PIXEL_SIZE;
-		const int screenHeightPxl = SCREEN_HEIGHT / PIXEL_SIZE;
-		if (pxlState == 0) {
-			//makes all pixels darker
-			for (int i = 0; i < SCREEN_WIDTH / PIXEL_SIZE; i++) {
-				for (int j = 0; j < SCREEN_HEIGHT / PIXEL_SIZE; j++) {
-					SDL_Rect newSquare = SDL_Rect{ i * PIXEL_SIZE, j * PIXEL_SIZE, PIXEL_SIZE, PIXEL_SIZE };
-					SDL_Color targetCol = GetPixel(i, j).Color;
-					SDL_SetRenderDrawColor(gRenderer, clampInt(targetCol.r - 25, 0, 254), clampInt(targetCol.g - 25, 0, 254), clampInt(targetCol.b - 25, 0, 254), targetCol.a);
-					SDL_RenderFillRect(gRenderer, &newSquare);
+	//---MARGOLUS ENGINE---
+	//moves everything in 2x2 blocks instead of the request buffer
+	namespace Margolus {
+		uint8_t ClassOf[MAX_MATERIALS];
+
+		//shared by all worlds, redone whenever the materials change
+		void UpdateClasses() {
+			for (size_t id = 0; id < MaterialCount; id++) {
+				const Material& material = Materials[id];
+				switch (material.Phase) {
+				case types::SOLID_STATIC: ClassOf[id] = SOLID; break;
+				case types::SOLID_POWDER: ClassOf[id] = POWDER; break;
+				case types::LIQUID: ClassOf[id] = LIQUID; break;
+				default: ClassOf[id] = material.AtomMass < AIR_ATOM_MASS ? LIGHT_GAS : HEAVY_GAS; break;
 				}
 			}
+			ClassOf[types::VACUUM] = EMPTY;
 		}
-		else {
-			for (int i = 0; i < SCREEN_WIDTH / PIXEL_SIZE; i++) {
-				for (int j = 0; j < SCREEN_HEIGHT / PIXEL_SIZE; j++) {
-					SDL_Rect newSquare = SDL_Rect{ i * PIXEL_SIZE, j * PIXEL_SIZE, PIXEL_SIZE, PIXEL_SIZE };
-					SDL_Color targetCol = GetPixel(i, j).Color;
-					SDL_SetRenderDrawColor(gRenderer, targetCol.r, targetCol.g, targetCol.b, targetCol.a);
-					SDL_RenderFillRect(gRenderer, &newSquare);
+
+		//outside the grid counts as a wall, so the blocks hanging over the edge on odd ticks work like any other
+		int ClassAt(size_t x, size_t y) { return InBounds(x, y) ? ClassOf[GetPixel(x, y).ID] : (int)SOLID; }
+
+		//a block on a chunk border is updated if any of its chunks is awake
+		bool IsBlockAwake(size_t x, size_t y) {
+			return IsChunkAwake(x / CHUNK_SIZE, y / CHUNK_SIZE) || IsChunkAwake((x + 1) / CHUNK_SIZE, (y + 1) / CHUNK_SIZE) ||
+				IsChunkAwake((x + 1) / CHUNK_SIZE, y / CHUNK_SIZE) || IsChunkAwake(x / CHUNK_SIZE, (y + 1) / CHUNK_SIZE);
+		}
+
+		/* One pass over the blocks, shifted by a cell on odd ticks so things can cross block edges.
+		* Blocks don't share cells, nothing has to be resolved between them */
+		void Step() {
+
+			//odd ticks start a cell before the grid
+			size_t start = 0 - (ActiveWorld->Tick & 1);
+			uint64_t bits = 0;
+			int bitsLeft = 0;
+			for (size_t y = start; y + 1 <= PIXELGRID_HEIGHT; y += 2)
+			for (size_t x = start; x + 1 <= PIXELGRID_WIDTH; x += 2) {
+				if (!IsBlockAwake(x, y)) { continue; }
+
+				const size_t cells[4] = { GetIndex(x, y), GetIndex(x + 1, y), GetIndex(x, y + 1), GetIndex(x + 1, y + 1) };
+				size_t key = BlockKey(ClassAt(x, y), ClassAt(x + 1, y), ClassAt(x, y + 1), ClassAt(x + 1, y + 1));
+
+				if (bitsLeft == 0) {
+					bits = Bitboard::NextRandomWord(ActiveWorld->RandomState);
+					bitsLeft = 64;
+				}
+				uint8_t move = Table[bits & 1][key];
+				bits >>= 1;
+				bitsLeft--;
+				if (move == IDENTITY) { continue; }
+
+				//walls never move, so slots outside the grid always keep their own cell and aren't read
+				Pixel block[4];
+				for (size_t slot = 0; slot < 4; slot++) {
+					if (((move >> (2 * slot)) & 3) != slot) { block[slot] = ActiveWorld->Pixels[cells[slot]]; }
+				}
+				for (size_t slot = 0; slot < 4; slot++) {
+					size_t from = (move >> (2 * slot)) & 3;
+					if (from == slot) { continue; }
+					ActiveWorld->Pixels[cells[slot]] = block[from];
+					WakeCell(cells[slot]);
+				}
+			}
+		}
+	}
+
+	//---HEAT---
+	const size_t HEAT_SUBSTEP = 4; //conduction runs every this many ticks
+	const float HEAT_EPSILON = 0.005f; //a chunk where no pair of cells exchanges more than this in a step is at equilibrium
+
+	//the change a cell is due for at its current temperature, nullptr if none
+	const PhaseChange* DuePhaseChange(const Pixel& cell) {
+		const Material& material = cell.Type();
+		if (material.Heating.Into >= 0 && cell.Temperature >= material.Heating.Point + material.Heating.LatentHeat) { return &material.Heating; }
+		if (material.Cooling.Into >= 0 && cell.Temperature <= material.Cooling.Point - material.Cooling.LatentHeat) { return &material.Cooling; }
+		return nullptr;
+	}
+
+	//turns a cell into another material, it keeps its moles and the mass audit is told where they went
+	void ConvertCell(size_t index, int into, float temperature) {
+		Pixel& cell = ActiveWorld->Pixels[index];
+		uint16_t moles = cell.Moles;
+		ActiveWorld->MolesConverted[cell.ID] -= moles;
+		ActiveWorld->MolesConverted[into] += moles;
+
+		cell = NewPixel((uint8_t)into);
+		cell.Moles = moles;
+		cell.Temperature = temperature;
+		WakeCell(index);
+		ActiveWorld->ChunkHeatAwake[(index % PIXELGRID_WIDTH) / CHUNK_SIZE + (index / PIXELGRID_WIDTH) / CHUNK_SIZE * CHUNKS_X] = true;
+	}
+
+	void ApplyPhaseChanges() {
+		for (size_t i = 0; i < ActiveWorld->PendingPhaseChanges.size(); i++) {
+			size_t index = ActiveWorld->PendingPhaseChanges[i];
+			const PhaseChange* change = DuePhaseChange(ActiveWorld->Pixels[index]);
+			if (change == nullptr) { continue; }
+
+			PhaseChange applied = *change;
+			ConvertCell(index, applied.Into, applied.Point);
+		}
+		ActiveWorld->PendingPhaseChanges.clear();
+	}
+
+	namespace Heat {
+		//one cell of padding all round, its conductivity stays 0 so the edge of the world insulates
+		const size_t PLANE_WIDTH = PIXELGRID_WIDTH + 2;
+		thread_local std::vector<float> TemperaturePlane(PLANE_WIDTH * (PIXELGRID_HEIGHT + 2));
+		thread_local std::vector<float> ConductivityPlane(PLANE_WIDTH * (PIXELGRID_HEIGHT + 2));
+		thread_local std::vector<float> NextPlane(PLANE_WIDTH * (PIXELGRID_HEIGHT + 2));
+
+		size_t PlaneIndex(size_t x, size_t y) { return x + 1 + (y + 1) * PLANE_WIDTH; }
+
+		//moving cells carry their heat, so chunks with movement conduct too
+		bool IsActive(size_t cx, size_t cy) { return ActiveWorld->ChunkHeatAwake[cx + cy * CHUNKS_X] || IsChunkAwake(cx, cy); }
+
+		template <typename Function>
+		void ForEachActiveRow(Function function) {
+			for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+				if (!IsActive(cx, cy)) { continue; }
+				size_t startX = cx * CHUNK_SIZE;
+				size_t endX = std::min(startX + CHUNK_SIZE, PIXELGRID_WIDTH);
+				for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++) {
+					function(cx, cy, startX, endX, y);
+				}
+			}
+		}
+
+		/* 5-point stencil on one row span, a pair of cells exchanges the smaller of their two
+		* conductivities times their difference so whatever one side loses the other gains.
+		* Plain float arrays with no branches, the compiler turns this into SIMD */
+		void ConductRow(const float* t, const float* c, float* next, size_t count) {
+			const float* up = t - PLANE_WIDTH;
+			const float* down = t + PLANE_WIDTH;
+			const float* cUp = c - PLANE_WIDTH;
+			const float* cDown = c + PLANE_WIDTH;
+			for (size_t i = 0; i < count; i++) {
+				next[i] = t[i] +
+					std::min(c[i], c[i - 1]) * (t[i - 1] - t[i]) +
+					std::min(c[i], c[i + 1]) * (t[i + 1] - t[i]) +
+					std::min(c[i], cUp[i]) * (up[i] - t[i]) +
+					std::min(c[i], cDown[i]) * (down[i] - t[i]);
+			}
+		}
+
+		//largest exchange between a cell of the span and its left or upper neighbour, the other two pairs belong to the next cells
+		float MaxFlowRow(const float* t, const float* c, size_t count) {
+			const float* up = t - PLANE_WIDTH;
+			const float* cUp = c - PLANE_WIDTH;
+			float flow = 0;
+			for (size_t i = 0; i < count; i++) {
+				flow = std::max(flow, std::min(c[i], c[i - 1]) * std::abs(t[i - 1] - t[i]));
+				flow = std::max(flow, std::min(c[i], cUp[i]) * std::abs(up[i] - t[i]));
+			}
+			return flow;
+		}
+
+		//what a cell of the plane would exchange with the cell at x, y if that one conducted, with its real conductivity
+		float FlowInto(size_t plane, size_t x, size_t y) {
+			const Pixel& cell = GetPixel(x, y);
+			return std::min(ConductivityPlane[plane], cell.Type().Conductivity) * std::abs(cell.Temperature - TemperaturePlane[plane]);
+		}
+
+		/* A sleeping chunk is an insulator in the plane, so the flow across its edge never shows up in MaxFlowRow.
+		* Its edge is checked against its real conductivities instead and it wakes up if heat would cross */
+		void WakeInactiveNeighbours() {
+			bool* next = ActiveWorld->ChunkHeatAwakeNext;
+			for (size_t cy = 0; cy < CHUNKS_Y; cy++)
+			for (size_t cx = 0; cx < CHUNKS_X; cx++) {
+				if (!IsActive(cx, cy)) { continue; }
+				size_t startX = cx * CHUNK_SIZE, endX = std::min(startX + CHUNK_SIZE, PIXELGRID_WIDTH);
+				size_t startY = cy * CHUNK_SIZE, endY = std::min(startY + CHUNK_SIZE, PIXELGRID_HEIGHT);
+				float left = 0, right = 0, up = 0, down = 0;
+				for (size_t y = startY; y < endY; y++) {
+					if (cx > 0 && !IsActive(cx - 1, cy)) { left = std::max(left, FlowInto(PlaneIndex(startX, y), startX - 1, y)); }
+					if (cx + 1 < CHUNKS_X && !IsActive(cx + 1, cy)) { right = std::max(right, FlowInto(PlaneIndex(endX - 1, y), endX, y)); }
+				}
+				for (size_t x = startX; x < endX; x++) {
+					if (cy > 0 && !IsActive(cx, cy - 1)) { up = std::max(up, FlowInto(PlaneIndex(x, startY), x, startY - 1)); }
+					if (cy + 1 < CHUNKS_Y && !IsActive(cx, cy + 1)) { down = std::max(down, FlowInto(PlaneIndex(x, endY - 1), x, endY)); }
+				}
+
+				//the chunk stays up too, both sides of the edge have to conduct in the same step
+				if (left > HEAT_EPSILON) { next[cx - 1 + cy * CHUNKS_X] = next[cx + cy * CHUNKS_X] = true; }
+				if (right > HEAT_EPSILON) { next[cx + 1 + cy * CHUNKS_X] = next[cx + cy * CHUNKS_X] = true; }
+				if (up > HEAT_EPSILON) { next[cx + (cy - 1) * CHUNKS_X] = next[cx + cy * CHUNKS_X] = true; }
+				if (down > HEAT_EPSILON) { next[cx + (cy + 1) * CHUNKS_X] = next[cx + cy * CHUNKS_X] = true; }
+			}
+		}
+
+		/* Only cells in active chunks conduct, everything else has conductivity 0 in the plane
+		* and acts as an insulator, so the total heat of the active region stays the same.
+		* Chunks that still had heat flowing wake their neighbours for the next step, and so does heat about to cross into a sleeping one */
+		void Conduct() {
+			ForEachActiveRow([](size_t, size_t, size_t startX, size_t endX, size_t y) {
+				for (size_t x = startX; x < endX; x++) {
+					const Pixel& cell = GetPixel(x, y);
+					TemperaturePlane[PlaneIndex(x, y)] = cell.Temperature;
+					ConductivityPlane[PlaneIndex(x, y)] = cell.Type().Conductivity;
+				}
+			});
+
+			std::fill(ActiveWorld->ChunkHeatAwakeNext, ActiveWorld->ChunkHeatAwakeNext + CHUNKS_X * CHUNKS_Y, false);
+			ForEachActiveRow([](size_t cx, size_t cy, size_t startX, size_t endX, size_t y) {
+				size_t start = PlaneIndex(startX, y);
+				ConductRow(&TemperaturePlane[start], &ConductivityPlane[start], &NextPlane[start], endX - startX);
+
+				if (MaxFlowRow(&TemperaturePlane[start], &ConductivityPlane[start], endX - startX) > HEAT_EPSILON) {
+					for (size_t i = 0; i < 5; i++) {
+						size_t nx = cx + (i == 1) - (i == 2);
+						size_t ny = cy + (i == 3) - (i == 4);
+						if (nx < CHUNKS_X && ny < CHUNKS_Y) { ActiveWorld->ChunkHeatAwakeNext[nx + ny * CHUNKS_X] = true; }
+					}
 				}
+			});
+			WakeInactiveNeighbours();
+
+			ForEachActiveRow([](size_t, size_t, size_t startX, size_t endX, size_t y) {
+				for (size_t x = startX; x < endX; x++) {
+					size_t i = PlaneIndex(x, y);
+					Pixel& cell = ActiveWorld->Pixels[GetIndex(x, y)];
+					cell.Temperature = NextPlane[i];
+					ConductivityPlane[i] = 0;
+					//only cells the step moved over a transition get looked at again
+					if (NextPlane[i] != TemperaturePlane[i] && DuePhaseChange(cell) != nullptr) { ActiveWorld->PendingPhaseChanges.push_back(GetIndex(x, y)); }
+				}
+			});
+			std::copy(ActiveWorld->ChunkHeatAwakeNext, ActiveWorld->ChunkHeatAwakeNext + CHUNKS_X * CHUNKS_Y, ActiveWorld->ChunkHeatAwake);
+		}
+	}
+
+	size_t HeatAwakeChunkCount() { return std::count(ActiveWorld->ChunkHeatAwake, ActiveWorld->ChunkHeatAwake + CHUNKS_X * CHUNKS_Y, true); }
+
+	//the next tick can't change anything unless something is painted: nothing moved, no heat is flowing and nothing is in flight
+	bool IsSettled() {
+		return std::count(ActiveWorld->ChunkAwakeNext, ActiveWorld->ChunkAwakeNext + CHUNKS_X * CHUNKS_Y, true) == 0 && HeatAwakeChunkCount() == 0 &&
+			ActiveWorld->FreeParticles.Size() == 0 && ActiveWorld->PendingPhaseChanges.empty() && ActiveWorld->PendingReactions.empty();
+	}
+
+	//---REACTIONS---
+	//one entry per ordered pair of materials, ProductA replaces the first cell and ProductB the second
+	struct Reaction {
+		uint8_t ProductA = 0;
+		uint8_t ProductB = 0;
+		uint16_t Chance = 0; //per tick and pair, out of 65535, 0 means the pair doesn't react
+		float Energy = 0.0f; //products come out at the pair's average temperature plus this
+	};
+
+	//MaterialCount x MaterialCount, row is the first material
+	std::vector<Reaction> Reactions;
+
+	const Reaction& GetReaction(uint8_t a, uint8_t b) { return Reactions[a * MaterialCount + b]; }
+
+
+	//checks the pairs with the right and lower neighbour, so every pair is seen once
+	void FindReactions(size_t x, size_t y) {
+		const Pixel& cell = GetPixel(x, y);
+		const size_t neighbours[2] = { GetIndex(x + 1, y), GetIndex(x, y + 1) };
+		const bool inBounds[2] = { x + 1 < PIXELGRID_WIDTH, y + 1 < PIXELGRID_HEIGHT };
+		for (size_t i = 0; i < 2; i++) {
+			if (!inBounds[i]) { continue; }
+			const Pixel& other = GetPixel(neighbours[i]);
+			const Reaction& reaction = GetReaction(cell.ID, other.ID);
+			if (reaction.Chance == 0) { continue; }
+
+			if ((Random() & 0xFFFF) < reaction.Chance) {
+				ActiveWorld->PendingReactions.push_back(ReactionRequest{ GetIndex(x, y), neighbours[i], cell.ID, other.ID });
 			}
-			if (pxlState == 2) {
-				//closest pixel to mouse is brighter
-				SDL_Rect newSquare = SDL_Rect{ closestPixel.x, closestPixel.y, PIXEL_SIZE, PIXEL_SIZE };
-				SDL_Color targetCol = GetPixel(closestPixel.x, closestPixel.y).Color;
-				newSquare.x *= PIXEL_SIZE;
-				newSquare.y *= PIXEL_SIZE;
-				SDL_SetRenderDrawColor(gRenderer, clampInt(targetCol.r + 50, 0, 254), clampInt(targetCol.g + 50, 0, 254), clampInt(targetCol.b + 50, 0, 254), targetCol.a);
-				SDL_RenderFillRect(gRenderer, &newSquare);
+			else {
+				//the pair can still react, don't let the chunk fall asleep on it
+				WakeCell(GetIndex(x, y));
+			}
+		}
+	}
+
+	//runs after the moves are committed, pairs that moved apart or already reacted are skipped
+	void ApplyReactions() {
+		for (size_t i = 0; i < ActiveWorld->PendingReactions.size(); i++) {
+			const ReactionRequest& request = ActiveWorld->PendingReactions[i];
+			if (GetPixel(request.IndexA).ID != request.IdA || GetPixel(request.IndexB).ID != request.IdB) { continue; }
+
+			const Reaction& reaction = GetReaction((uint8_t)request.IdA, (uint8_t)request.IdB);
+			float temperature = 0.5f * (GetPixel(request.IndexA).Temperature + GetPixel(request.IndexB).Temperature) + reaction.Energy;
+			ConvertCell(request.IndexA, reaction.ProductA, temperature);
+			ConvertCell(request.IndexB, reaction.ProductB, temperature);
+
+			//hot products can be due for a phase change straight away
+			if (DuePhaseChange(GetPixel(request.IndexA)) != nullptr) { ActiveWorld->PendingPhaseChanges.push_back(request.IndexA); }
+			if (DuePhaseChange(GetPixel(request.IndexB)) != nullptr) { ActiveWorld->PendingPhaseChanges.push_back(request.IndexB); }
+		}
+		ActiveWorld->PendingReactions.clear();
+	}
+
+	//reaction table for a parsed set, both orders of every reaction are filled in
+	void BuildReactionTable(const MaterialSet& set, std::vector<Reaction>& table) {
+		size_t count = set.Materials.size();
+		table.assign(count * count, Reaction{});
+		for (const ReactionRule& rule : set.Reactions) {
+			//a probability of 0 switches the pair off, anything above it reacts at least now and then
+			uint16_t chance = rule.Probability <= 0 ? 0 : (uint16_t)std::max(1.0f, std::min(rule.Probability, 1.0f) * 65535.0f);
+			table[rule.A * count + rule.B] = Reaction{ (uint8_t)rule.ProductA, (uint8_t)rule.ProductB, chance, rule.Energy };
+			table[rule.B * count + rule.A] = Reaction{ (uint8_t)rule.ProductB, (uint8_t)rule.ProductA, chance, rule.Energy };
+		}
+	}
+
+	//puts a set and its prebuilt reaction table in place, table gets the old one back
+	//no allocation, call between ticks
+	void SwapMaterials(const MaterialSet& set, std::vector<Reaction>& table) {
+		MaterialCount = set.Materials.size();
+		std::copy(set.Materials.begin(), set.Materials.end(), Materials);
+		for (size_t i = 0; i < MaterialCount; i++) { snprintf(MaterialNames[i], sizeof(MaterialNames[i]), "%s", set.Names[i].c_str()); }
+		Reactions.swap(table);
+		Margolus::UpdateClasses();
+		MaterialsVersion++;
+	}
+
+	void InstallMaterials(const MaterialSet& set) {
+		std::vector<Reaction> table;
+		BuildReactionTable(set, table);
+		SwapMaterials(set, table);
+		Margolus::BuildTable();
+	}
+
+	bool LoadMaterials(const std::string& path, std::string& error) {
+		MaterialSet set;
+		if (!MaterialFile::Load(path, set, error)) { return false; }
+		InstallMaterials(set);
+		return true;
+	}
+
+	//copies every cell's id into the world's packed id plane
+	void PackIds() {
+		for (size_t i = 0; i < PIXELGRID_SIZE; i++) { ActiveWorld->Ids[i] = ActiveWorld->Pixels[i].ID; }
+	}
+
+	//a full cell of the material, or an empty one for vacuum
+	void PaintCell(size_t index, uint8_t id) {
+		if (id == types::VACUUM) { SetPixel(index, Pixel()); }
+		else {
+			SetPixel(index, NewPixel(id));
+			ActiveWorld->Pixels[index].Moles = MOLES_PER_PIXEL;
+			//a material spawned past one of its transitions changes with the next heat step
+			if (DuePhaseChange(ActiveWorld->Pixels[index]) != nullptr) { ActiveWorld->PendingPhaseChanges.push_back(index); }
+		}
+		WakeCell(index);
+		ActiveWorld->EditCount++;
+	}
+
+	//every cell on the line from start to end, in cells, one step per cell
+	void PaintLine(Vector2 start, Vector2 end, uint8_t id) {
+		double length = std::sqrt((end.x - start.x) * (end.x - start.x) + (end.y - start.y) * (end.y - start.y));
+		double dx = length > 0 ? (end.x - start.x) / length : 0;
+		double dy = length > 0 ? (end.y - start.y) / length : 0;
+		for (double walked = 0; walked <= length; walked += 1.0) {
+			double x = std::floor(start.x + dx * walked);
+			double y = std::floor(start.y + dy * walked);
+			if (x >= 0 && y >= 0 && InBounds((size_t)x, (size_t)y)) { PaintCell(GetIndex((size_t)x, (size_t)y), id); }
+		}
+	}
+
+	//one unpaused tick with whatever the Use flags say, the engines in Engine.h set them
+	void StepTick() {
+		BeginChunkTick();
+
+		//gravity updates, the block engine moves everything itself and leaves the request buffer empty
+		if (ActiveWorld->UseMargolus) { Margolus::Step(); }
+		else if (ActiveWorld->UseBitboardKernel) { Bitboard::UpdatePowders(); }
+		for (size_t cx = 0; cx < CHUNKS_X; cx++)
+		for (size_t cy = 0; cy < CHUNKS_Y; cy++) {
+			if (!IsChunkAwake(cx, cy)) { continue; }
+
+			for (size_t x = cx * CHUNK_SIZE; x < std::min((cx + 1) * CHUNK_SIZE, PIXELGRID_WIDTH); x++)
+			for (size_t y = cy * CHUNK_SIZE; y < std::min((cy + 1) * CHUNK_SIZE, PIXELGRID_HEIGHT); y++) {
+				FindReactions(x, y);
+				if (ActiveWorld->UseMargolus) {}
+				else if (ActiveWorld->UseSpecialisedKernels) { UpdatePixelsMoveSpecialised(x, y); }
+				else { UpdatePixelsMove(x, y); }
 			}
 		}
+		LiftPendingPixels();
+
+		CommitPixels();
+
+		ApplyReactions();
+		EqualizeLiquids();
+		Gas::Spread();
+		StepParticles();
+		if (ActiveWorld->Tick % HEAT_SUBSTEP == 0) {
+			Heat::Conduct();
+			ApplyPhaseChanges();
+		}
+		ActiveWorld->Tick++;
 	}
-}
\ No newline at end of file
+}
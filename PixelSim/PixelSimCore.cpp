@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string>
+
+#include "PixelSimCore.h"
+#include "Pixel.h"
+#include "Engine.h"
+
+struct PxlWorld {
+	Pxl::World World;
+	Pxl::Engine* Engine = &Pxl::Engines::Specialised;
+};
+
+namespace {
+	//makes the world active on this thread for as long as it lives
+	struct ActiveScope {
+		Pxl::World* Previous;
+		ActiveScope(PxlWorld* world) : Previous(Pxl::ActiveWorld) { Pxl::SetActiveWorld(world->World); }
+		~ActiveScope() { Pxl::SetActiveWorld(*Previous); }
+	};
+}
+
+int Pxl_LoadMaterials(const char* path, char* error, size_t errorSize) {
+	std::string message;
+	Pxl::BitboardUseAVX2 = Pxl::Bitboard::HasAVX2();
+	if (Pxl::LoadMaterials(path, message)) { return 1; }
+	if (error != NULL && errorSize > 0) { snprintf(error, errorSize, "%s", message.c_str()); }
+	return 0;
+}
+
+int Pxl_MaterialCount(void) { return (int)Pxl::MaterialCount; }
+
+const char* Pxl_MaterialName(int id) {
+	if (id < 0 || (size_t)id >= Pxl::MaterialCount) { return NULL; }
+	return Pxl::MaterialNames[id];
+}
+
+int Pxl_FindMaterial(const char* name) { return Pxl::FindMaterial(name); }
+
+int Pxl_GridWidth(void) { return (int)Pxl::PIXELGRID_WIDTH; }
+int Pxl_GridHeight(void) { return (int)Pxl::PIXELGRID_HEIGHT; }
+
+PxlWorld* Pxl_CreateWorld(uint64_t seed) {
+	PxlWorld* world = new PxlWorld();
+	ActiveScope scope(world);
+	Pxl::SeedRandom(seed);
+	world->Engine->Init();
+	Pxl::PackIds();
+	return world;
+}
+
+void Pxl_DestroyWorld(PxlWorld* world) { delete world; }
+
+void Pxl_SetEngine(PxlWorld* world, PxlEngine engine) {
+	if ((size_t)engine >= Pxl::Engines::COUNT) { return; }
+	ActiveScope scope(world);
+	world->Engine = Pxl::Engines::All[engine];
+	world->Engine->Init();
+}
+
+void Pxl_Step(PxlWorld* world, int ticks) {
+	ActiveScope scope(world);
+	for (int i = 0; i < ticks; i++) { world->Engine->Step(); }
+	Pxl::PackIds();
+}
+
+uint64_t Pxl_GetTick(const PxlWorld* world) { return world->World.Tick; }
+
+void Pxl_Paint(PxlWorld* world, int x, int y, int id) { Pxl_PaintRect(world, x, y, 1, 1, id); }
+
+void Pxl_PaintRect(PxlWorld* world, int x, int y, int w, int h, int id) {
+	if (id < 0 || (size_t)id >= Pxl::MaterialCount) { return; }
+	ActiveScope scope(world);
+	for (int cy = std::max(y, 0); cy < std::min(y + h, (int)Pxl::PIXELGRID_HEIGHT); cy++)
+	for (int cx = std::max(x, 0); cx < std::min(x + w, (int)Pxl::PIXELGRID_WIDTH); cx++) {
+		size_t index = Pxl::GetIndex(cx, cy);
+		Pxl::PaintCell(index, (uint8_t)id);
+		world->World.Ids[index] = (uint8_t)id;
+	}
+}
+
+const uint8_t* Pxl_GetIds(const PxlWorld* world) { return world->World.Ids; }
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+* C interface to the simulation core, for tools that drive the engine without the game window.
+* Materials are shared by every world, load them once before creating worlds and not while any is stepping.
+* Worlds can be stepped on different threads at the same time, one world only on one thread at a time.
+*/
+
+#if defined(_WIN32) && defined(PXL_CORE_EXPORTS)
+#define PXL_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define PXL_API __declspec(dllimport)
+#else
+#define PXL_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PxlWorld PxlWorld;
+
+//same order as the game's F2 list
+typedef enum PxlEngine {
+	PXL_ENGINE_REFERENCE,
+	PXL_ENGINE_SPECIALISED,
+	PXL_ENGINE_BITBOARD,
+	PXL_ENGINE_MARGOLUS
+} PxlEngine;
+
+//returns 1 on success, otherwise 0 and the reason in error, which can be NULL
+PXL_API int Pxl_LoadMaterials(const char* path, char* error, size_t errorSize);
+PXL_API int Pxl_MaterialCount(void);
+PXL_API const char* Pxl_MaterialName(int id);
+//-1 if there is no such material
+PXL_API int Pxl_FindMaterial(const char* name);
+
+//every world has the size the core was built with
+PXL_API int Pxl_GridWidth(void);
+PXL_API int Pxl_GridHeight(void);
+
+//an empty world on the specialised engine, the seed makes runs reproducible
+PXL_API PxlWorld* Pxl_CreateWorld(uint64_t seed);
+PXL_API void Pxl_DestroyWorld(PxlWorld* world);
+
+PXL_API void Pxl_SetEngine(PxlWorld* world, PxlEngine engine);
+PXL_API void Pxl_Step(PxlWorld* world, int ticks);
+PXL_API uint64_t Pxl_GetTick(const PxlWorld* world);
+
+//a full cell of the material, 0 (vacuum) clears. cells outside the world are skipped
+PXL_API void Pxl_Paint(PxlWorld* world, int x, int y, int id);
+PXL_API void Pxl_PaintRect(PxlWorld* world, int x, int y, int w, int h, int id);
+
+/* The material id of every cell, a packed plane the world keeps, nothing is copied for the caller.
+* Cell (x, y) is at ids[x + y * Pxl_GridWidth()], one byte per cell. Valid until the world is destroyed,
+* brought up to date when Pxl_Step, Pxl_Paint and Pxl_PaintRect return */
+PXL_API const uint8_t* Pxl_GetIds(const PxlWorld* world);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Pixel.h"
+#include "Texels.h"
+#include "Workers.h"
+#include "Camera.h"
+#include "Mips.h"
+
+/*
+* Draws the cells the camera sees into a streaming texture with TEXTURE_SCALE texels per cell, the renderer scales it up to the window.
+* Zoomed out far enough that several cells share a window pixel, the texels come from the level of the mip pyramid that fits instead.
+* Colours come from palettes built once per material set, cells only carry their id and
+* the shade of a cell is picked from a hash of its position.
+*/
+namespace Pxl {
+	namespace Palette {
+		const int VARIANT_BITS = Texels::VARIANT_BITS;
+		const int VARIANTS = 1 << VARIANT_BITS; //shades per material
+
+		enum Modes {
+			NORMAL,
+			DIMMED, //the whole world while a menu is open
+			HIGHLIGHT, //the cell under the mouse
+			MODE_COUNT
+		};
+
+		//ARGB8888, indexed by id * VARIANTS + variant
+		uint32_t Colors[MODE_COUNT][MAX_MATERIALS * VARIANTS];
+		size_t BuiltFor = (size_t)-1; //MaterialsVersion the colours are from
+		//VariantAt of every cell of the world and of each mip level, worked out once
+		std::vector<uint8_t> Variants[Mips::MAX_LEVELS + 1];
+
+		uint32_t ARGB(int r, int g, int b, int a) { return (uint32_t)a << 24 | (uint32_t)r << 16 | (uint32_t)g << 8 | (uint32_t)b; }
+
+		uint32_t Shade(const RGBA& color, int offset, int max) {
+			return ARGB(std::min(std::max(color.r + offset, 0), max), std::min(std::max(color.g + offset, 0), max), std::min(std::max(color.b + offset, 0), max), color.a);
+		}
+
+		//variants are spread evenly over the material's variance, darkest first
+		void Build() {
+			for (size_t id = 0; id < MaterialCount; id++) {
+				const Material& material = Materials[id];
+				for (int variant = 0; variant < VARIANTS; variant++) {
+					int offset = material.ColorVariance > 0 ? -material.ColorVariance + (2 * material.ColorVariance * variant + (VARIANTS - 1) / 2) / (VARIANTS - 1) : 0;
+					Colors[NORMAL][id * VARIANTS + variant] = Shade(material.Color, offset, 255);
+					Colors[DIMMED][id * VARIANTS + variant] = Shade(material.Color, offset - 25, 254);
+					Colors[HIGHLIGHT][id * VARIANTS + variant] = Shade(material.Color, offset + 50, 254);
+				}
+			}
+			BuiltFor = MaterialsVersion;
+		}
+
+		//the same place always gets the same shade
+		int VariantAt(size_t x, size_t y) {
+			uint32_t hash = (uint32_t)x * 0x9E3779B1u ^ (uint32_t)y * 0x85EBCA77u;
+			hash ^= hash >> 15;
+			hash *= 0x2C1B3C6Du;
+			hash ^= hash >> 13;
+			return (int)(hash >> (32 - VARIANT_BITS));
+		}
+
+		//rebuilds after a materials reload
+		void Update() {
+			if (BuiltFor != MaterialsVersion) { Build(); }
+		}
+
+		const uint8_t* VariantPlane(int level, size_t width, size_t height) {
+			std::vector<uint8_t>& plane = Variants[level];
+			if (plane.empty()) {
+				plane.resize(width * height);
+				for (size_t y = 0; y < height; y++)
+				for (size_t x = 0; x < width; x++) { plane[x + y * width] = (uint8_t)VariantAt(x, y); }
+			}
+			return plane.data();
+		}
+
+		uint32_t Color(int mode, uint8_t id, size_t x, size_t y) { return Colors[mode][id * VARIANTS + VariantAt(x, y)]; }
+	}
+
+	//texels per cell along each side, 1 leaves the scaling to the GPU. PIXEL_SIZE draws at window resolution
+	const int TEXTURE_SCALE = 1;
+
+	//below this many texels a frame the rows are converted on the main thread, waking the workers costs more
+	const size_t PARALLEL_TEXELS = 256 * 1024;
+	//bands per thread, so a slow thread doesn't hold up the frame
+	const size_t BANDS_PER_THREAD = 4;
+
+	//grows to the largest view so far, the world can be much bigger
+	SDL_Texture* WorldTexture = nullptr;
+	int WorldTextureWidth = 0;
+	int WorldTextureHeight = 0;
+	//converts row bands alongside the main thread, none on a single core
+	std::unique_ptr<Workers::Pool> RenderWorkers;
+
+	//zoomed out overview of the world the game shows
+	Mips::Pyramid Overview;
+
+	//what a frame is drawn from, the world itself at level 0 or a level of the pyramid
+	struct IdPlane {
+		int Level;
+		const uint8_t* Ids;
+		size_t Stride; //bytes between two ids
+		size_t Width;
+		const uint8_t* Variants;
+	};
+
+	IdPlane PlaneAt(int level) {
+		if (level == 0) { return IdPlane{ 0, &ActiveWorld->Pixels[0].ID, sizeof(Pixel), PIXELGRID_WIDTH, Palette::VariantPlane(0, PIXELGRID_WIDTH, PIXELGRID_HEIGHT) }; }
+		const Mips::Level& mip = Overview.Get(level);
+		return IdPlane{ level, mip.Ids.data(), 1, mip.Width, Palette::VariantPlane(level, mip.Width, mip.Height) };
+	}
+
+	//the coarsest level where a texel still covers no more than one window pixel
+	int DetailLevel(double zoom) {
+		int level = 0;
+		while (level < Mips::MAX_LEVELS && (double)(2 << level) <= 1.0 / zoom) { level++; }
+		return level;
+	}
+
+	//count texels of row y from x into scale rows of out, pitch in bytes
+	void ConvertRow(const IdPlane& plane, size_t x, size_t y, size_t count, uint32_t* out, int pitch, const uint32_t* colors, int scale) {
+		size_t first = x + y * plane.Width;
+		Texels::ConvertRow(plane.Ids + first * plane.Stride, plane.Stride, plane.Variants + first, count, colors, out, scale, Texels::Level);
+		for (int i = 1; i < scale; i++) { memcpy((uint8_t*)out + i * pitch, out, count * scale * sizeof(uint32_t)); }
+	}
+
+	//x and y are relative to the drawn texels
+	void FillCell(uint32_t* pixels, int pitch, int scale, size_t x, size_t y, uint32_t color) {
+		for (int i = 0; i < scale; i++) {
+			uint32_t* row = (uint32_t*)((uint8_t*)pixels + (y * scale + i) * pitch) + x * scale;
+			for (int j = 0; j < scale; j++) { row[j] = color; }
+		}
+	}
+
+	bool InCells(const SDL_Rect& cells, int x, int y) { return x >= cells.x && y >= cells.y && x < cells.x + cells.w && y < cells.y + cells.h; }
+
+	/* The area of the plane into an ARGB8888 buffer of scale texels per plane cell starting at area.x, area.y, pitch in bytes.
+	* At a mip level area is in that level's cells, the highlight and particles land on the block they are in */
+	void DrawWorld(uint32_t* pixels, int pitch, int scale, const IdPlane& plane, SDL_Rect area, SDL_Point closestPixel, int pxlState) {
+		Palette::Update();
+		int mode = pxlState == 0 ? Palette::DIMMED : Palette::NORMAL;
+		size_t rows = (size_t)area.h;
+		size_t bands = 1;
+		if (RenderWorkers && (size_t)area.w * area.h * scale * scale >= PARALLEL_TEXELS) {
+			bands = std::min(rows, (RenderWorkers->ThreadCount() + 1) * BANDS_PER_THREAD);
+		}
+		//the bands only write their own rows, the overlays below go on once they are all done
+		auto band = [&](size_t i) {
+			for (size_t row = rows * i / bands; row < rows * (i + 1) / bands; row++) {
+				ConvertRow(plane, area.x, area.y + row, area.w, (uint32_t*)((uint8_t*)pixels + row * scale * pitch), pitch, Palette::Colors[mode], scale);
+			}
+		};
+		if (bands > 1) { RenderWorkers->Run(bands, band); }
+		else { band(0); }
+
+		//closest pixel to mouse is brighter
+		int x = closestPixel.x >> plane.Level;
+		int y = closestPixel.y >> plane.Level;
+		if (pxlState == 2 && closestPixel.x >= 0 && closestPixel.y >= 0 && InBounds(closestPixel.x, closestPixel.y) && InCells(area, x, y)) {
+			FillCell(pixels, pitch, scale, x - area.x, y - area.y, Palette::Color(Palette::HIGHLIGHT, GetPixel(closestPixel.x, closestPixel.y).ID, x, y));
+		}
+
+		const Particles::ParticleBuffer<Pixel>& particles = ActiveWorld->FreeParticles;
+		for (size_t i = 0; i < particles.Size(); i++) {
+			if (particles.X[i] < 0 || particles.Y[i] < 0) { continue; }
+			x = (int)particles.X[i] >> plane.Level;
+			y = (int)particles.Y[i] >> plane.Level;
+			if (!InCells(area, x, y)) { continue; }
+			FillCell(pixels, pitch, scale, x - area.x, y - area.y, Palette::Color(mode, particles.Payloads[i].ID, x, y));
+		}
+	}
+
+	//recreated bigger when the view needs more texels than it has
+	bool FitWorldTexture(int width, int height) {
+		if (WorldTexture != nullptr && width <= WorldTextureWidth && height <= WorldTextureHeight) { return true; }
+		SDL_DestroyTexture(WorldTexture);
+		WorldTextureWidth = std::max(width, WorldTextureWidth);
+		WorldTextureHeight = std::max(height, WorldTextureHeight);
+		WorldTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WorldTextureWidth, WorldTextureHeight);
+		if (WorldTexture == nullptr) {
+			printf("Unable to create the world texture! SDL Error: %s\n", SDL_GetError());
+			WorldTextureWidth = 0;
+			WorldTextureHeight = 0;
+			return false;
+		}
+		SDL_SetTextureBlendMode(WorldTexture, SDL_BLENDMODE_NONE);
+		return true;
+	}
+
+	//only what the camera sees is converted and uploaded
+	void LoadPixels(SDL_Point closestPixel, int pxlState) {
+		if (!RenderWorkers) { RenderWorkers.reset(new Workers::Pool(std::max(1u, std::thread::hardware_concurrency()) - 1)); }
+		SDL_Rect cells = View.VisibleCells();
+		if (cells.w == 0 || cells.h == 0) { return; }
+
+		int level = DetailLevel(View.Zoom);
+		if (level > 0) {
+			Overview.Update();
+			level = std::min(level, Overview.LevelCount());
+		}
+		//the blocks of the level that cover the visible cells, and the cells they cover
+		SDL_Rect area = SDL_Rect{ cells.x >> level, cells.y >> level, 0, 0 };
+		area.w = ((cells.x + cells.w - 1) >> level) - area.x + 1;
+		area.h = ((cells.y + cells.h - 1) >> level) - area.y + 1;
+		SDL_Rect covered = SDL_Rect{ area.x << level, area.y << level, 0, 0 };
+		covered.w = std::min((area.x + area.w) << level, (int)PIXELGRID_WIDTH) - covered.x;
+		covered.h = std::min((area.y + area.h) << level, (int)PIXELGRID_HEIGHT) - covered.y;
+
+		SDL_Rect texels = SDL_Rect{ 0, 0, area.w * TEXTURE_SCALE, area.h * TEXTURE_SCALE };
+		if (!FitWorldTexture(texels.w, texels.h)) { return; }
+
+		void* pixels;
+		int pitch;
+		if (SDL_LockTexture(WorldTexture, &texels, &pixels, &pitch) != 0) { return; }
+		DrawWorld((uint32_t*)pixels, pitch, TEXTURE_SCALE, PlaneAt(level), area, closestPixel, pxlState);
+		SDL_UnlockTexture(WorldTexture);
+
+		SDL_FRect screen = View.CellsToScreen(covered);
+		SDL_RenderCopyF(gRenderer, WorldTexture, &texels, &screen);
+	}
+
+	void CloseRenderer() {
+		SDL_DestroyTexture(WorldTexture);
+		WorldTexture = nullptr;
+		WorldTextureWidth = 0;
+		WorldTextureHeight = 0;
+		RenderWorkers.reset();
+	}
+}
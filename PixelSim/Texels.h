@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Bitboard.h"
+
+/*
+* Material ids to ARGB8888 texels. A cell's texel is colors[id << VARIANT_BITS | variant], and it is written
+* scale times along the row, the caller copies the row down for the other scale - 1 rows.
+* Ids are read with a stride so the kernels can take them straight from the world's cells.
+*/
+namespace Pxl {
+	namespace Texels {
+
+		const int VARIANT_BITS = 3;
+		//the AVX2 kernel falls back to scalar above this
+		const int MAX_SCALE = 32;
+
+		enum Levels {
+			SCALAR,
+			AVX2
+		};
+
+		//picked at startup
+		int Level = SCALAR;
+
+		int Detect() {
+			if (Bitboard::HasAVX2()) { return AVX2; }
+			return SCALAR;
+		}
+
+		void ConvertRowScalar(const uint8_t* ids, size_t idStride, const uint8_t* variants, size_t count, const uint32_t* colors, uint32_t* out, int scale) {
+			for (size_t x = 0; x < count; x++) {
+				uint32_t texel = colors[(uint32_t)ids[x * idStride] << VARIANT_BITS | variants[x]];
+				for (int i = 0; i < scale; i++) { out[x * scale + i] = texel; }
+			}
+		}
+
+#if PXL_X86
+		//eight cells at a time, ids and colours are gathered
+		PXL_AVX2_TARGET void ConvertRowAVX2(const uint8_t* ids, size_t idStride, const uint8_t* variants, size_t count, const uint32_t* colors, uint32_t* out, int scale) {
+			if (scale > MAX_SCALE) {
+				ConvertRowScalar(ids, idStride, variants, count, colors, out, scale);
+				return;
+			}
+			__m256i spread[MAX_SCALE];
+			for (int chunk = 0; chunk < scale; chunk++) {
+				int lanes[8];
+				for (int i = 0; i < 8; i++) { lanes[i] = (chunk * 8 + i) / scale; }
+				spread[chunk] = _mm256_loadu_si256((const __m256i*)lanes);
+			}
+			const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)idStride));
+			const __m256i lowByte = _mm256_set1_epi32(0xFF);
+
+			//the id gather reads 4 bytes from each cell, the last one has to stay inside the row
+			size_t x = 0;
+			for (; (x + 7) * idStride + 4 <= count * idStride; x += 8) {
+				__m256i id = _mm256_and_si256(_mm256_i32gather_epi32((const int*)(ids + x * idStride), offsets, 1), lowByte);
+				__m256i variant = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(variants + x)));
+				__m256i index = _mm256_or_si256(_mm256_slli_epi32(id, VARIANT_BITS), variant);
+				__m256i texels = _mm256_i32gather_epi32((const int*)colors, index, 4);
+
+				uint32_t* at = out + x * scale;
+				if (scale == 1) { _mm256_storeu_si256((__m256i*)at, texels); }
+				else {
+					for (int chunk = 0; chunk < scale; chunk++) { _mm256_storeu_si256((__m256i*)(at + chunk * 8), _mm256_permutevar8x32_epi32(texels, spread[chunk])); }
+				}
+			}
+			ConvertRowScalar(ids + x * idStride, idStride, variants + x, count - x, colors, out + x * scale, scale);
+		}
+#endif
+
+		void ConvertRow(const uint8_t* ids, size_t idStride, const uint8_t* variants, size_t count, const uint32_t* colors, uint32_t* out, int scale, int level) {
+#if PXL_X86
+			if (level == AVX2) { ConvertRowAVX2(ids, idStride, variants, count, colors, out, scale); return; }
+#endif
+			ConvertRowScalar(ids, idStride, variants, count, colors, out, scale);
+		}
+	}
+}
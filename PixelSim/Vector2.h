@@ -0,0 +1,6 @@
+#pragma once
+
+struct Vector2 {
+	double x = 0;
+	double y = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Threads that stay up between jobs, for work that is split up every frame where starting threads would cost more than the work.
+* A job is a count of independent pieces, the threads and the caller take pieces until none are left.
+*/
+namespace Pxl {
+	namespace Workers {
+
+		class Pool {
+		public:
+			//threads besides the caller, 0 runs every job on the caller
+			Pool(size_t threadCount) {
+				for (size_t i = 0; i < threadCount; i++) { Threads.emplace_back([this]() { Loop(); }); }
+			}
+
+			~Pool() {
+				{
+					std::lock_guard<std::mutex> lock(Lock);
+					Stopping = true;
+				}
+				Wake.notify_all();
+				for (std::thread& thread : Threads) { thread.join(); }
+			}
+
+			Pool(const Pool&) = delete;
+			Pool& operator=(const Pool&) = delete;
+
+			size_t ThreadCount() const { return Threads.size(); }
+
+			//task(i) for every i below count, returns once all of them are done. one job at a time
+			void Run(size_t count, const std::function<void(size_t)>& task) {
+				if (Threads.empty() || count < 2) {
+					for (size_t i = 0; i < count; i++) { task(i); }
+					return;
+				}
+				{
+					std::lock_guard<std::mutex> lock(Lock);
+					Task = &task;
+					Count = count;
+					Next = 0;
+					Busy = Threads.size();
+					Job++;
+				}
+				Wake.notify_all();
+				Work();
+
+				std::unique_lock<std::mutex> lock(Lock);
+				Done.wait(lock, [this]() { return Busy == 0; });
+				Task = nullptr;
+			}
+
+		private:
+			std::vector<std::thread> Threads;
+			std::mutex Lock;
+			std::condition_variable Wake;
+			std::condition_variable Done;
+			const std::function<void(size_t)>* Task = nullptr;
+			size_t Count = 0;
+			std::atomic<size_t> Next{ 0 };
+			size_t Busy = 0; //threads still on the current job
+			uint64_t Job = 0;
+			bool Stopping = false;
+
+			void Work() {
+				for (size_t i = Next++; i < Count; i = Next++) { (*Task)(i); }
+			}
+
+			void Loop() {
+				uint64_t seen = 0;
+				while (true) {
+					{
+						std::unique_lock<std::mutex> lock(Lock);
+						Wake.wait(lock, [&]() { return Stopping || Job != seen; });
+						if (Stopping) { return; }
+						seen = Job;
+					}
+					Work();
+					std::lock_guard<std::mutex> lock(Lock);
+					if (--Busy == 0) { Done.notify_one(); }
+				}
+			}
+		};
+	}
+}
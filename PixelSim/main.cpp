@@ -13,10 +13,15 @@ SDL_Surface* gScreenSurface = NULL;
 const int SCREEN_WIDTH = 640 * 2;
 const int SCREEN_HEIGHT = 480 * 2;
 const int SCREEN_FPS = 60;
-const int SCREEN_TICKS_PER_FRAME = 1000 / SCREEN_FPS;
 
 const int PIXEL_SIZE = 8 * 1;
 
+//window pixels the camera moves per arrow key press
+const int PAN_STEP = 64;
+
+//how long an idle loop sleeps waiting for input before it looks for reloaded materials again
+const int IDLE_WAIT_MS = 100;
+
 const int screenWidthPxl = SCREEN_WIDTH / PIXEL_SIZE;
 const int screenHeightPxl = SCREEN_HEIGHT / PIXEL_SIZE;
 
@@ -39,9 +44,24 @@ SDL_Point mPositionOld = SDL_Point();
 
 Uint32 mButton = NULL;
 
+//fills the window by default, bigger worlds are explored with the camera
+#ifndef PXL_GRID_WIDTH
+#define PXL_GRID_WIDTH (SCREEN_WIDTH / PIXEL_SIZE)
+#endif
+#ifndef PXL_GRID_HEIGHT
+#define PXL_GRID_HEIGHT (SCREEN_HEIGHT / PIXEL_SIZE)
+#endif
+
 #include "Pixel.h"
+#include "Engine.h"
+#include "Game.h"
+#include "Render.h"
+#include "Audit.h"
+#include "HotReload.h"
+#include "Pacer.h"
 #include "Graphics.h"
 #include "Gui.h"
+#include "Bench.h"
 
 bool init()
 {
@@ -102,12 +122,31 @@ bool init()
                         success = false;
                     }
 
+                    //materials come from a file next to the executable
+                    std::string materialError;
+                    if (!Pxl::LoadMaterials("Materials.txt", materialError))
+                    {
+                        printf("Failed to load materials! %s\n", materialError.c_str());
+                        success = false;
+                    }
+                    else
+                    {
+                        //picks up edits to the file while running
+                        HotReload::Start("Materials.txt");
+                    }
+
+                    //powders go through the bitboard kernel when the cpu can run it
+                    Pxl::BitboardUseAVX2 = Pxl::Bitboard::HasAVX2();
+                    Pxl::SelectEngine(Pxl::BitboardUseAVX2 ? (Pxl::Engine&)Pxl::Engines::BitboardPowders : Pxl::Engines::Specialised);
+                    Pxl::Texels::Level = Pxl::Texels::Detect();
+
                     for (int i = 0; i < Pxl::PIXELGRID_SIZE; i++) {
-                        Pxl::SetPixel(i, Pxl::Pixels[Pxl::types::VACUUM]);
+                        Pxl::SetPixel(i, Pxl::Pixel());
                     }
 
                     //adding menu gui
                     Gui::Guis.push_back(std::make_unique<Gui::Types::Menu>(SDL_Point{ SCREEN_WIDTH - 17 * 4, -68 * 2 }));
+                    Gui::Guis.push_back(std::make_unique<Gui::Types::Minimap>(SDL_Point{ 20, SCREEN_HEIGHT - 20 }));
                 }
             }
         }
@@ -130,6 +169,9 @@ void close()
     gRenderer = nullptr;
 
     //free additional pointers
+    Pxl::CloseRenderer();
+
+    HotReload::Stop();
 
     //Quit SDL subsystems
     IMG_Quit();
@@ -139,6 +181,12 @@ void close()
 
 int main(int argc, char* args[])
 {
+    //headless benchmark, doesn't open a window
+    if (argc > 1 && std::string(args[1]) == "--bench")
+    {
+        return Bench::Run();
+    }
+
     //Start up SDL and create window
     if (!init())
     {
@@ -150,36 +198,31 @@ int main(int argc, char* args[])
         bool continueMouse = false;
         bool isPaused = false;
 
-        //The frames per second timer
-        LTimer fpsTimer;
-
-        //The frames per second cap timer
-        LTimer capTimer;
-
-        //Start counting frames per second
-        int countedFrames = 0;
-        fpsTimer.start();
+        //holds the loop to SCREEN_FPS and measures how even the frames are
+        Pacer::FramePacer pacer(SCREEN_FPS);
         SDL_Point closestPixel = SDL_Point{ 0, 0 };
 
         Uint64 ticksNow = SDL_GetPerformanceCounter();
         Uint64 ticksLast = 0;
 
-        Uint32 mTicksCount = 0;
-
         //pause button's texture settings
         SDL_Texture* pauseTexture = Gfx::loadTexture("Gfx/Gui/Pause/Pause.png");
         SDL_SetTextureBlendMode(pauseTexture, SDL_BLENDMODE_BLEND);
         SDL_SetTextureAlphaMod(pauseTexture, 100);
 
+        /* Nothing moved last frame, no gui is animating and there was no input. The loop then sleeps until an event
+        * comes in instead of ticking, drawing and presenting the same frame again */
+        bool isIdle = false;
+
         while (!quit)
         {
-            //Start cap timer
-            capTimer.start();
-
             bool mouseClick = false;
-            //Handle events on queue
-            while (SDL_PollEvent(&gCurrentEvent) != 0)
+            bool hadInput = false;
+            //Handle events on queue, idle waits for the first one
+            bool hasEvent = isIdle ? SDL_WaitEventTimeout(&gCurrentEvent, IDLE_WAIT_MS) != 0 : SDL_PollEvent(&gCurrentEvent) != 0;
+            while (hasEvent)
             {
+                hadInput = true;
                 switch (gCurrentEvent.type) {
 
                     case SDL_QUIT:
@@ -191,13 +234,55 @@ int main(int argc, char* args[])
                     case SDL_MOUSEBUTTONUP:
                         Gui::mouseInGui = false;
                         break;
+                    case SDL_MOUSEWHEEL:
+                        Pxl::View.ZoomAt(mPosition, pow(Pxl::Camera::ZOOM_STEP, gCurrentEvent.wheel.y));
+                        break;
                     case SDL_KEYDOWN:
                         switch (gCurrentEvent.key.keysym.sym) {
                             case SDLK_F1:
                                 isPaused = !isPaused;
                                 break;
+                            case SDLK_F2:
+                                if (!Pxl::Validation::Enabled) { Pxl::NextEngine(); }
+                                break;
+                            case SDLK_F3:
+                                Audit::SetEnabled(!Audit::Enabled);
+                                break;
+                            case SDLK_F4:
+                                Pxl::Validation::SetEnabled(!Pxl::Validation::Enabled);
+                                break;
+                            case SDLK_F5:
+                                if (pacer.SetVSync(gRenderer, !pacer.IsVSync())) { printf("vsync %s\n", pacer.IsVSync() ? "on" : "off"); }
+                                else { printf("vsync not supported: %s\n", SDL_GetError()); }
+                                break;
+                            case SDLK_LEFT:
+                                Pxl::View.Pan(-PAN_STEP, 0);
+                                break;
+                            case SDLK_RIGHT:
+                                Pxl::View.Pan(PAN_STEP, 0);
+                                break;
+                            case SDLK_UP:
+                                Pxl::View.Pan(0, -PAN_STEP);
+                                break;
+                            case SDLK_DOWN:
+                                Pxl::View.Pan(0, PAN_STEP);
+                                break;
+                            case SDLK_HOME:
+                                Pxl::View.Reset();
+                                break;
                         }
                 }
+                hasEvent = SDL_PollEvent(&gCurrentEvent) != 0;
+            }
+
+            if (isIdle && !hadInput)
+            {
+                //a materials reload wakes everything up
+                isIdle = !HotReload::Apply();
+                //the time spent waiting doesn't count as a frame
+                ticksNow = SDL_GetPerformanceCounter();
+                pacer.Restart();
+                continue;
             }
 
             mPositionOld = mPosition;
@@ -205,8 +290,8 @@ int main(int argc, char* args[])
             clampInt(&mPosition.x, -1, SCREEN_WIDTH);
             clampInt(&mPosition.y, -1, SCREEN_HEIGHT);
 
-            //Calculate fps
-            float avgFPS = countedFrames / (fpsTimer.getTicks() / 1000.f);
+            //dragging with the middle button moves the camera
+            if (mButton & SDL_BUTTON_MMASK) { Pxl::View.Pan(mPositionOld.x - mPosition.x, mPositionOld.y - mPosition.y); }
 
             //Calculate deltaTime 
             ticksLast = ticksNow;
@@ -222,8 +307,10 @@ int main(int argc, char* args[])
             pxlState = Gui::UpdateGuis(mouseClick, deltaTime);
 
             if (pxlState != 0 && Gui::mouseInGui == false) {
-                if (pxlState != 1) { closestPixel = SDL_Point{ (int)floor(mPosition.x / PIXEL_SIZE), (int)floor(mPosition.y / PIXEL_SIZE) }; }
+                if (pxlState != 1) { closestPixel = Pxl::View.CellAt(mPosition); }
+                HotReload::Apply();
                 Pxl::UpdatePixels(isPaused, mPosition, mPositionOld, mButton, mouseClick, pxlState);
+                Audit::Check();
             }
 
             //---DRAW---
@@ -234,7 +321,7 @@ int main(int argc, char* args[])
             //Draw screen
             Pxl::LoadPixels(closestPixel, pxlState);
             if (pxlState != 0) { Gfx::DrawCoordinates(closestPixel); }
-            Gfx::DrawFPScounter(avgFPS);
+            Gfx::DrawFPScounter(pacer.Stats());
             Gui::DrawGuis();
 
             if (isPaused) {
@@ -242,17 +329,12 @@ int main(int argc, char* args[])
                 SDL_RenderCopy(gRenderer, pauseTexture, NULL, new SDL_Rect{SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT / 2 - 200, 400, 400});
             }
 
-            //capping refresh rate stuff
             SDL_RenderPresent(gRenderer);
-            countedFrames++;
 
-            //If frame finished early
-            int frameTicks = capTimer.getTicks();
-            if (frameTicks < SCREEN_TICKS_PER_FRAME)
-            {
-                //Wait remaining time
-                SDL_Delay(SCREEN_TICKS_PER_FRAME - frameTicks);
-            }
+            isIdle = !hadInput && mButton == 0 && !Gui::AnyAnimating() && !Pxl::Validation::Enabled && (isPaused || Pxl::IsSettled());
+
+            //waits out the rest of the frame, or for vsync the present already did
+            pacer.EndFrame();
         }
     }
 